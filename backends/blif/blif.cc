@@ -52,40 +52,60 @@ struct BlifDumper
 	CellTypes ct;
 
 	BlifDumper(FILE *f, RTLIL::Module *module, RTLIL::Design *design, BlifDumperConfig *config) :
-			f(f), module(module), design(design), config(config), ct(design)
+			f(f), module(module), design(design), config(config), ct(design), cstr_buf_idx(0)
 	{
 	}
 
-	std::vector<std::string> cstr_buf;
+	// the strings returned by cstr() are kept in a small ring buffer, so they
+	// stay valid for the next few calls (enough for one fprintf() call). the
+	// escaped names of wires are cached, as they are used for every bit.
+	std::string cstr_buf[16];
+	int cstr_buf_idx;
+	std::map<RTLIL::Wire*, std::string> wire_names;
 
-	const char *cstr(RTLIL::IdString id)
+	static std::string escape_name(RTLIL::IdString id)
 	{
 		std::string str = RTLIL::unescape_id(id);
 		for (size_t i = 0; i < str.size(); i++)
 			if (str[i] == '#' || str[i] == '=')
 				str[i] = '?';
-		cstr_buf.push_back(str);
-		return cstr_buf.back().c_str();
+		return str;
+	}
+
+	const char *cstr(RTLIL::IdString id)
+	{
+		std::string &str = cstr_buf[cstr_buf_idx++ % 16];
+		str = escape_name(id);
+		return str.c_str();
 	}
 
-	const char *cstr(RTLIL::SigSpec sig)
+	const char *cstr(const RTLIL::SigSpec &sig)
 	{
-		sig.optimize();
 		log_assert(sig.width == 1);
 
-		if (sig.chunks.at(0).wire == NULL)
-			return sig.chunks.at(0).data.bits.at(0) == RTLIL::State::S1 ?  "$true" : "$false";
+		RTLIL::SigBit bit;
+		if (sig.chunks.size() == 1) {
+			bit = RTLIL::SigBit(sig);
+		} else {
+			RTLIL::SigSpec sig_opt = sig;
+			sig_opt.optimize();
+			bit = RTLIL::SigBit(sig_opt);
+		}
 
-		std::string str = RTLIL::unescape_id(sig.chunks.at(0).wire->name);
-		for (size_t i = 0; i < str.size(); i++)
-			if (str[i] == '#' || str[i] == '=')
-				str[i] = '?';
+		if (bit.wire == NULL)
+			return bit.data == RTLIL::State::S1 ?  "$true" : "$false";
 
-		if (sig.chunks.at(0).wire->width != 1)
-			str += stringf("[%d]", sig.chunks.at(0).offset);
+		auto it = wire_names.find(bit.wire);
+		if (it == wire_names.end())
+			it = wire_names.insert(std::pair<RTLIL::Wire*, std::string>(bit.wire, escape_name(bit.wire->name))).first;
 
-		cstr_buf.push_back(str);
-		return cstr_buf.back().c_str();
+		if (bit.wire->width == 1)
+			return it->second.c_str();
+
+		std::string &str = cstr_buf[cstr_buf_idx++ % 16];
+		str = it->second;
+		str += stringf("[%d]", bit.offset);
+		return str.c_str();
 	}
 
 	const char *subckt_or_gate(std::string cell_type)
@@ -274,6 +294,8 @@ struct BlifBackend : public Backend {
 		log("\n");
 		log("Write the current design to an BLIF file.\n");
 		log("\n");
+		log("The output is compressed with gzip if the filename ends in '.gz'.\n");
+		log("\n");
 		log("    -top top_module\n");
 		log("        set the specified module as design top module\n");
 		log("\n");
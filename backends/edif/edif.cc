@@ -26,6 +26,7 @@
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
 #include <string>
+#include <algorithm>
 #include <assert.h>
 
 #define EDIF_DEF(_id) edif_names(RTLIL::unescape_id(_id), true).c_str()
@@ -83,6 +84,27 @@ namespace
 			return gen_name;
 		}
 	};
+
+	// a reference to a bit of a module port (cell == NULL) or of a cell port,
+	// the index is -1 for single bit ports. the portRef strings are only
+	// created when the net is written.
+	struct EdifPortRef
+	{
+		RTLIL::Cell *cell;
+		const std::string *port;
+		int index;
+	};
+
+	// order signal bits by name, like the corresponding 1-bit SigSpecs
+	struct EdifSigBitCmp
+	{
+		bool operator()(const RTLIL::SigBit &a, const RTLIL::SigBit &b) const
+		{
+			if (a.wire != b.wire)
+				return (a.wire && b.wire) ? a.wire->name < b.wire->name : a.wire < b.wire;
+			return a.wire ? a.offset < b.offset : a.data < b.data;
+		}
+	};
 }
 
 struct EdifBackend : public Backend {
@@ -95,6 +117,8 @@ struct EdifBackend : public Backend {
 		log("\n");
 		log("Write the current design to an EDIF netlist file.\n");
 		log("\n");
+		log("The output is compressed with gzip if the filename ends in '.gz'.\n");
+		log("\n");
 		log("    -top top_module\n");
 		log("        set the specified module as design top module\n");
 		log("\n");
@@ -248,7 +272,7 @@ struct EdifBackend : public Backend {
 				continue;
 
 			SigMap sigmap(module);
-			std::map<RTLIL::SigSpec, std::set<std::string>> net_join_db;
+			std::map<RTLIL::SigBit, std::vector<EdifPortRef>, EdifSigBitCmp> net_join_db;
 
 			fprintf(f, "    (cell %s\n", EDIF_DEF(module->name));
 			fprintf(f, "      (cellType GENERIC)\n");
@@ -267,12 +291,12 @@ struct EdifBackend : public Backend {
 				if (wire->width == 1) {
 					fprintf(f, "          (port %s (direction %s))\n", EDIF_DEF(wire->name), dir);
 					RTLIL::SigSpec sig = sigmap(RTLIL::SigSpec(wire));
-					net_join_db[sig].insert(stringf("(portRef %s)", EDIF_REF(wire->name)));
+					net_join_db[RTLIL::SigBit(sig)].push_back(EdifPortRef{NULL, &wire->name, -1});
 				} else {
 					fprintf(f, "          (port (array %s %d) (direction %s))\n", EDIF_DEF(wire->name), wire->width, dir);
 					for (int i = 0; i < wire->width; i++) {
 						RTLIL::SigSpec sig = sigmap(RTLIL::SigSpec(wire, 1, i));
-						net_join_db[sig].insert(stringf("(portRef (member %s %d))", EDIF_REF(wire->name), i));
+						net_join_db[RTLIL::SigBit(sig)].push_back(EdifPortRef{NULL, &wire->name, i});
 					}
 				}
 			}
@@ -307,34 +331,50 @@ struct EdifBackend : public Backend {
 				for (auto &p : cell->connections) {
 					RTLIL::SigSpec sig = sigmap(p.second);
 					sig.expand();
-					for (int i = 0; i < sig.width; i++) {
-						RTLIL::SigSpec sigbit(sig.chunks.at(i));
-						if (sig.width == 1)
-							net_join_db[sigbit].insert(stringf("(portRef %s (instanceRef %s))", EDIF_REF(p.first), EDIF_REF(cell->name)));
-						else
-							net_join_db[sigbit].insert(stringf("(portRef (member %s %d) (instanceRef %s))", EDIF_REF(p.first), i, EDIF_REF(cell->name)));
-					}
+					// assign the EDIF names in the same order as when the portRef strings are created
+					EDIF_REF(p.first);
+					for (int i = 0; i < sig.width; i++)
+						net_join_db[RTLIL::SigBit(sig.chunks.at(i))].push_back(EdifPortRef{cell, &p.first, sig.width == 1 ? -1 : i});
 				}
 			}
 			for (auto &it : net_join_db) {
-				RTLIL::SigSpec sig = it.first;
-				sig.optimize();
-				log_assert(sig.width == 1);
-				if (sig.chunks.at(0).wire == NULL) {
-					if (sig.chunks.at(0).data.bits.at(0) != RTLIL::State::S0 && sig.chunks.at(0).data.bits.at(0) != RTLIL::State::S1)
-						continue;
+				const RTLIL::SigBit &bit = it.first;
+				if (bit.wire == NULL && bit.data != RTLIL::State::S0 && bit.data != RTLIL::State::S1)
+					continue;
+
+				// same net name as log_signal() with spaces and backslashes removed
+				std::string netname;
+				if (bit.wire == NULL)
+					netname = bit.data == RTLIL::State::S1 ? "1'1" : "1'0";
+				else {
+					for (char ch : bit.wire->name)
+						if (ch != ' ' && ch != '\\')
+							netname += ch;
+					if (bit.wire->width != 1)
+						netname += stringf("[%d]", bit.offset);
 				}
-				std::string netname = log_signal(sig);
-				for (size_t i = 0; i < netname.size(); i++)
-					if (netname[i] == ' ' || netname[i] == '\\')
-						netname.erase(netname.begin() + i--);
+
+				std::vector<std::string> refs;
+				for (auto &ref : it.second) {
+					if (ref.cell == NULL && ref.index < 0)
+						refs.push_back(stringf("(portRef %s)", EDIF_REF(*ref.port)));
+					else if (ref.cell == NULL)
+						refs.push_back(stringf("(portRef (member %s %d))", EDIF_REF(*ref.port), ref.index));
+					else if (ref.index < 0)
+						refs.push_back(stringf("(portRef %s (instanceRef %s))", EDIF_REF(*ref.port), EDIF_REF(ref.cell->name)));
+					else
+						refs.push_back(stringf("(portRef (member %s %d) (instanceRef %s))", EDIF_REF(*ref.port), ref.index, EDIF_REF(ref.cell->name)));
+				}
+				std::sort(refs.begin(), refs.end());
+				refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+
 				fprintf(f, "          (net %s (joined\n", EDIF_DEF(netname));
-				for (auto &ref : it.second)
+				for (auto &ref : refs)
 					fprintf(f, "            %s\n", ref.c_str());
-				if (sig.chunks.at(0).wire == NULL) {
-					if (sig.chunks.at(0).data.bits.at(0) == RTLIL::State::S0)
+				if (bit.wire == NULL) {
+					if (bit.data == RTLIL::State::S0)
 						fprintf(f, "            (portRef G (instanceRef GND))\n");
-					if (sig.chunks.at(0).data.bits.at(0) == RTLIL::State::S1)
+					if (bit.data == RTLIL::State::S1)
 						fprintf(f, "            (portRef P (instanceRef VCC))\n");
 				}
 				fprintf(f, "          ))\n");
@@ -31,21 +31,29 @@
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
 #include <assert.h>
+#include <string.h>
+#include <errno.h>
 #include <string>
 #include <sstream>
 #include <set>
 #include <map>
+#include <atomic>
+#include <thread>
 
 namespace {
 
 bool norename, noattr, attr2comment, noexpr;
-int auto_name_counter, auto_name_offset, auto_name_digits;
-std::map<std::string, int> auto_name_map;
+CellTypes reg_ct;
 
-std::set<std::string> reg_wires;
+// the per-module state is thread local so that modules can be dumped in parallel
+thread_local int auto_name_counter, auto_name_offset, auto_name_digits;
+thread_local std::map<std::string, int> auto_name_map;
+thread_local std::set<std::string> reg_wires;
+thread_local RTLIL::Module *active_module;
 
-CellTypes reg_ct;
-RTLIL::Module *active_module;
+// when set, log messages from dump_module() are collected here instead
+// of being written to the log right away (used by the worker threads)
+thread_local std::string *deferred_log;
 
 void reset_auto_counter_id(const std::string &id, bool may_rename)
 {
@@ -91,19 +99,27 @@ void reset_auto_counter(RTLIL::Module *module)
 	for (size_t i = 10; i < auto_name_offset + auto_name_map.size(); i = i*10)
 		auto_name_digits++;
 
-	for (auto it = auto_name_map.begin(); it != auto_name_map.end(); it++)
-		log("  renaming `%s' to `_%0*d_'.\n", it->first.c_str(), auto_name_digits, auto_name_offset + it->second);
+	for (auto it = auto_name_map.begin(); it != auto_name_map.end(); it++) {
+		std::string msg = stringf("  renaming `%s' to `_%0*d_'.\n", it->first.c_str(), auto_name_digits, auto_name_offset + it->second);
+		if (deferred_log != NULL)
+			deferred_log->append(msg);
+		else
+			log("%s", msg.c_str());
+	}
 }
 
-std::string id(std::string internal_id, bool may_rename = true)
+std::string id(const std::string &internal_id, bool may_rename = true)
 {
 	const char *str = internal_id.c_str();
 	bool do_escape = false;
 
-	if (may_rename && auto_name_map.count(internal_id) != 0) {
-		char buffer[100];
-		snprintf(buffer, 100, "_%0*d_", auto_name_digits, auto_name_offset + auto_name_map[internal_id]);
-		return std::string(buffer);
+	if (may_rename && !auto_name_map.empty()) {
+		auto it = auto_name_map.find(internal_id);
+		if (it != auto_name_map.end()) {
+			char buffer[100];
+			snprintf(buffer, 100, "_%0*d_", auto_name_digits, auto_name_offset + it->second);
+			return std::string(buffer);
+		}
 	}
 
 	if (*str == '\\')
@@ -167,20 +183,22 @@ void dump_const(FILE *f, RTLIL::Const &data, int width = -1, int offset = 0, boo
 			fprintf(f, "%d", val);
 		} else {
 	dump_bits:
-			fprintf(f, "%d'%sb", width, set_signed ? "s" : "");
+			// build the bit string first and write it with a single call
+			std::string bits = stringf("%d'%sb", width, set_signed ? "s" : "");
 			if (width == 0)
-				fprintf(f, "0");
+				bits += '0';
 			for (int i = offset+width-1; i >= offset; i--) {
 				assert(i < (int)data.bits.size());
 				switch (data.bits[i]) {
-				case RTLIL::S0: fprintf(f, "0"); break;
-				case RTLIL::S1: fprintf(f, "1"); break;
-				case RTLIL::Sx: fprintf(f, "x"); break;
-				case RTLIL::Sz: fprintf(f, "z"); break;
-				case RTLIL::Sa: fprintf(f, "z"); break;
+				case RTLIL::S0: bits += '0'; break;
+				case RTLIL::S1: bits += '1'; break;
+				case RTLIL::Sx: bits += 'x'; break;
+				case RTLIL::Sz: bits += 'z'; break;
+				case RTLIL::Sa: bits += 'z'; break;
 				case RTLIL::Sm: log_error("Found marker state in final netlist.");
 				}
 			}
+			fputs(bits.c_str(), f);
 		}
 	} else {
 		fprintf(f, "\"");
@@ -209,7 +227,7 @@ void dump_sigchunk(FILE *f, RTLIL::SigChunk &chunk, bool no_decimal = false)
 		dump_const(f, chunk.data, chunk.width, chunk.offset, no_decimal);
 	} else {
 		if (chunk.width == chunk.wire->width && chunk.offset == 0)
-			fprintf(f, "%s", id(chunk.wire->name).c_str());
+			fputs(id(chunk.wire->name).c_str(), f);
 		else if (chunk.width == 1)
 			fprintf(f, "%s[%d]", id(chunk.wire->name).c_str(), chunk.offset + chunk.wire->start_offset);
 		else
@@ -979,6 +997,10 @@ struct VerilogBackend : public Backend {
 		log("        only write selected modules. modules must be selected entirely or\n");
 		log("        not at all.\n");
 		log("\n");
+		log("    -j <num_threads>\n");
+		log("        render the modules in memory using the specified number of threads.\n");
+		log("        the modules are written to the output file in the usual order.\n");
+		log("\n");
 	}
 	virtual void execute(FILE *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
 	{
@@ -991,12 +1013,13 @@ struct VerilogBackend : public Backend {
 
 		bool blackboxes = false;
 		bool selected = false;
+		int num_threads = 0;
 
 		reg_ct.clear();
 		reg_ct.setup_stdcells_mem();
-		reg_ct.cell_types.insert("$sr");
-		reg_ct.cell_types.insert("$dff");
-		reg_ct.cell_types.insert("$adff");
+		reg_ct.setup_type("$sr", { "\\SET", "\\CLR" }, { "\\Q" });
+		reg_ct.setup_type("$dff", { "\\CLK", "\\D" }, { "\\Q" });
+		reg_ct.setup_type("$adff", { "\\CLK", "\\ARST", "\\D" }, { "\\Q" });
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -1025,11 +1048,17 @@ struct VerilogBackend : public Backend {
 				selected = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_threads = atoi(args[++argidx].c_str());
+				if (num_threads < 1)
+					cmd_error(args, argidx, "Number of threads must be positive.");
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
 
-		fprintf(f, "/* Generated by %s */\n", yosys_version_str);
+		std::vector<RTLIL::Module*> modules;
 		for (auto it = design->modules.begin(); it != design->modules.end(); it++) {
 			if (it->second->get_bool_attribute("\\blackbox") != blackboxes)
 				continue;
@@ -1038,8 +1067,58 @@ struct VerilogBackend : public Backend {
 					log_cmd_error("Can't handle partially selected module %s!\n", RTLIL::id2cstr(it->first));
 				continue;
 			}
-			log("Dumping module `%s'.\n", it->first.c_str());
-			dump_module(f, "", it->second);
+			modules.push_back(it->second);
+		}
+
+		fprintf(f, "/* Generated by %s */\n", yosys_version_str);
+
+		if (num_threads > 0)
+		{
+			// render each module into its own memory buffer, the buffers
+			// and the log messages are then written in the original order
+			struct dump_job_t {
+				RTLIL::Module *module;
+				std::string log_messages;
+				FILE *memf;
+				char *buffer;
+				size_t size;
+			};
+			std::vector<dump_job_t> jobs(modules.size());
+			for (size_t i = 0; i < modules.size(); i++) {
+				jobs[i].module = modules[i];
+				jobs[i].memf = open_memstream(&jobs[i].buffer, &jobs[i].size);
+				if (jobs[i].memf == NULL)
+					log_error("Can't create memory stream for module `%s': %s\n", modules[i]->name.c_str(), strerror(errno));
+			}
+
+			std::atomic<size_t> next_job(0);
+			std::vector<std::thread> workers;
+			for (int i = 0; i < num_threads && i < int(jobs.size()); i++)
+				workers.push_back(std::thread([&]() {
+					for (size_t idx = next_job++; idx < jobs.size(); idx = next_job++) {
+						dump_job_t &job = jobs[idx];
+						deferred_log = &job.log_messages;
+						dump_module(job.memf, "", job.module);
+						deferred_log = NULL;
+						fclose(job.memf);
+					}
+				}));
+			for (auto &worker : workers)
+				worker.join();
+
+			for (auto &job : jobs) {
+				log("Dumping module `%s'.\n", job.module->name.c_str());
+				log("%s", job.log_messages.c_str());
+				fwrite(job.buffer, 1, job.size, f);
+				free(job.buffer);
+			}
+		}
+		else
+		{
+			for (auto module : modules) {
+				log("Dumping module `%s'.\n", module->name.c_str());
+				dump_module(f, "", module);
+			}
 		}
 
 		reg_ct.clear();
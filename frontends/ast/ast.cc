@@ -27,21 +27,25 @@
  */
 
 #include "kernel/log.h"
+#include "kernel/register.h"
 #include "libs/sha1/sha1.h"
+#include "backends/ilang/ilang_backend.h"
 #include "ast.h"
 
 #include <sstream>
 #include <stdarg.h>
 #include <assert.h>
+#include <unistd.h>
 
 using namespace AST;
 using namespace AST_INTERNAL;
 
 // instanciate global variables (public API)
 namespace AST {
-	std::string current_filename;
-	void (*set_line_num)(int) = NULL;
-	int (*get_line_num)() = NULL;
+	thread_local std::string current_filename;
+	thread_local void (*set_line_num)(int) = NULL;
+	thread_local int (*get_line_num)() = NULL;
+	std::string derive_cache_dir;
 }
 
 // instanciate global variables (private API)
@@ -886,6 +890,36 @@ AstModule::~AstModule()
 		delete ast;
 }
 
+// serialize an AST subtree (used to create the keys for the derive cache)
+static void ast_hash_data(AstNode *node, std::vector<unsigned char> &data)
+{
+	std::string str = stringf("%d %s:%d %s %d%d%d%d%d%d %d %d %d %d ", node->type, node->filename.c_str(), node->linenum, node->str.c_str(),
+			node->is_input, node->is_output, node->is_reg, node->is_signed, node->is_string, node->range_valid,
+			node->port_id, node->range_left, node->range_right, node->integer);
+	data.insert(data.end(), str.begin(), str.end());
+	data.insert(data.end(), node->bits.begin(), node->bits.end());
+	data.push_back(0xff);
+	for (auto &attr : node->attributes) {
+		data.insert(data.end(), attr.first.begin(), attr.first.end());
+		data.push_back(0);
+		ast_hash_data(attr.second, data);
+	}
+	data.push_back('(');
+	for (auto child : node->children)
+		ast_hash_data(child, data);
+	data.push_back(')');
+}
+
+static std::string sha1_hex(const std::vector<unsigned char> &data)
+{
+	unsigned char hash[20];
+	sha1::calc(data.data(), data.size(), hash);
+
+	char hexstring[41];
+	sha1::toHexString(hash, hexstring);
+	return hexstring;
+}
+
 // create a new parametric module (when needed) and return the name of the generated module
 RTLIL::IdString AstModule::derive(RTLIL::Design *design, std::map<RTLIL::IdString, RTLIL::Const> parameters)
 {
@@ -896,30 +930,17 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, std::map<RTLIL::IdStrin
 
 	log_header("Executing AST frontend in derive mode using pre-parsed AST for module `%s'.\n", stripped_name.c_str());
 
-	current_ast = NULL;
-	flag_dump_ast1 = false;
-	flag_dump_ast2 = false;
-	flag_dump_vlog = false;
-	flag_nolatches = nolatches;
-	flag_nomem2reg = nomem2reg;
-	flag_mem2reg = mem2reg;
-	flag_lib = lib;
-	flag_noopt = noopt;
-	flag_icells = icells;
-	flag_autowire = autowire;
-	use_internal_line_num();
-
 	std::string para_info;
 	std::vector<unsigned char> hash_data;
 	hash_data.insert(hash_data.end(), stripped_name.begin(), stripped_name.end());
 	hash_data.push_back(0);
 
-	AstNode *new_ast = ast->clone();
-
+	// first pass: only look at the parameters to determine the name of the derived
+	// module, so that a cached module can be returned without cloning the AST
+	std::map<std::string, RTLIL::Const> new_parameters;
 	int para_counter = 0;
 	int orig_parameters_n = parameters.size();
-	for (auto it = new_ast->children.begin(); it != new_ast->children.end(); it++) {
-		AstNode *child = *it;
+	for (auto child : ast->children) {
 		if (child->type != AST_PARAMETER)
 			continue;
 		para_counter++;
@@ -928,8 +949,7 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, std::map<RTLIL::IdStrin
 			log("Parameter %s = %s\n", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[child->str])));
 	rewrite_parameter:
 			para_info += stringf("%s=%s", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[para_id])));
-			delete child->children.at(0);
-			child->children[0] = AstNode::mkconst_bits(parameters[para_id].bits, (parameters[para_id].flags & RTLIL::CONST_FLAG_SIGNED) != 0);
+			new_parameters[child->str] = parameters[para_id];
 			hash_data.insert(hash_data.end(), child->str.begin(), child->str.end());
 			hash_data.push_back(0);
 			hash_data.insert(hash_data.end(), parameters[para_id].bits.begin(), parameters[para_id].bits.end());
@@ -949,35 +969,88 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, std::map<RTLIL::IdStrin
 	std::string modname;
 
 	if (orig_parameters_n == 0)
-	{
 		modname = stripped_name;
-	}
+	else if (para_info.size() > 60)
+		modname = "$paramod$" + sha1_hex(hash_data) + stripped_name;
 	else
-	if (para_info.size() > 60)
-	{
-		unsigned char hash[20];
-		unsigned char *hash_data2 = new unsigned char[hash_data.size()];
-		for (size_t i = 0; i < hash_data.size(); i++)
-			hash_data2[i] = hash_data[i];
-		sha1::calc(hash_data2, hash_data.size(), hash);
-		delete[] hash_data2;
-
-		char hexstring[41];
-		sha1::toHexString(hash, hexstring);
+		modname = "$paramod" + stripped_name + para_info;
 
-		modname = "$paramod$" + std::string(hexstring) + stripped_name;
+	if (design->modules.count(modname) != 0) {
+		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
+		return modname;
 	}
-	else
+
+	// the persistent derive cache is keyed on the module AST, the frontend
+	// options and the parameters, so stale entries are simply never hit.
+	// only $paramod modules are cached: a module loaded from the cache is a
+	// plain RTLIL::Module without the AST, so it can't be derived again, and
+	// modules without parameters (e.g. from $abstract modules) may still be
+	// instantiated with parameters later.
+	std::string cache_filename;
+	if (!derive_cache_dir.empty() && orig_parameters_n > 0)
 	{
-		modname = "$paramod" + stripped_name + para_info;
+		std::vector<unsigned char> key_data;
+		std::string key_info = stringf("%s\n%d%d%d%d%d%d%d\n", yosys_version_str, nolatches, nomem2reg, mem2reg, lib, noopt, icells, autowire);
+		key_data.insert(key_data.end(), key_info.begin(), key_info.end());
+		key_data.insert(key_data.end(), hash_data.begin(), hash_data.end());
+		ast_hash_data(ast, key_data);
+		cache_filename = derive_cache_dir + "/" + sha1_hex(key_data) + ".il";
+
+		FILE *f = fopen(cache_filename.c_str(), "r");
+		if (f != NULL) {
+			log("Loading RTLIL representation for module `%s' from derive cache file `%s'.\n", modname.c_str(), cache_filename.c_str());
+			RTLIL::Design *cache_design = new RTLIL::Design;
+			Frontend::frontend_call(cache_design, f, cache_filename, "ilang");
+			fclose(f);
+			if (cache_design->modules.size() == 1 && cache_design->modules.count(modname) == 1) {
+				design->modules[modname] = cache_design->modules.at(modname);
+				cache_design->modules.clear();
+				delete cache_design;
+				return modname;
+			}
+			log("Ignoring derive cache file `%s' with unexpected content.\n", cache_filename.c_str());
+			delete cache_design;
+		}
 	}
 
-	if (design->modules.count(modname) == 0) {
-		new_ast->str = modname;
-		design->modules[modname] = process_module(new_ast, false);
-		design->modules[modname]->check();
-	} else {
-		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
+	current_ast = NULL;
+	flag_dump_ast1 = false;
+	flag_dump_ast2 = false;
+	flag_dump_vlog = false;
+	flag_nolatches = nolatches;
+	flag_nomem2reg = nomem2reg;
+	flag_mem2reg = mem2reg;
+	flag_lib = lib;
+	flag_noopt = noopt;
+	flag_icells = icells;
+	flag_autowire = autowire;
+	use_internal_line_num();
+
+	AstNode *new_ast = ast->clone();
+
+	for (auto child : new_ast->children) {
+		if (child->type != AST_PARAMETER || new_parameters.count(child->str) == 0)
+			continue;
+		RTLIL::Const &value = new_parameters.at(child->str);
+		delete child->children.at(0);
+		child->children[0] = AstNode::mkconst_bits(value.bits, (value.flags & RTLIL::CONST_FLAG_SIGNED) != 0);
+	}
+
+	new_ast->str = modname;
+	design->modules[modname] = process_module(new_ast, false);
+	design->modules[modname]->check();
+
+	if (!cache_filename.empty()) {
+		// write to a temporary file first so concurrent yosys runs never see partial files
+		std::string tmp_filename = stringf("%s.%d.tmp", cache_filename.c_str(), int(getpid()));
+		FILE *f = fopen(tmp_filename.c_str(), "w");
+		if (f != NULL) {
+			ILANG_BACKEND::dump_module(f, "", design->modules[modname], design, false);
+			fclose(f);
+			if (rename(tmp_filename.c_str(), cache_filename.c_str()) != 0)
+				remove(tmp_filename.c_str());
+		} else
+			log("Can't write derive cache file `%s'.\n", tmp_filename.c_str());
 	}
 
 	delete new_ast;
@@ -1003,7 +1076,7 @@ RTLIL::Module *AstModule::clone() const
 
 // internal dummy line number callbacks
 namespace {
-	int internal_line_num;
+	thread_local int internal_line_num;
 	void internal_set_line_num(int n) {
 		internal_line_num = n;
 	}
@@ -37,6 +37,29 @@
 using namespace AST;
 using namespace AST_INTERNAL;
 
+// bind a name in current_scope and remember the old binding in an undo log,
+// restore_scope() reverts all bindings in the log in reverse order. this is
+// used instead of saving and restoring copies of the whole scope.
+typedef std::vector<std::pair<std::string, AstNode*>> scope_undo_log_t;
+
+static void bind_scope(scope_undo_log_t &undo_log, const std::string &name, AstNode *node)
+{
+	AstNode *&slot = current_scope[name];
+	undo_log.push_back(std::pair<std::string, AstNode*>(name, slot));
+	slot = node;
+}
+
+static void restore_scope(scope_undo_log_t &undo_log)
+{
+	for (auto it = undo_log.rbegin(); it != undo_log.rend(); it++) {
+		if (it->second == NULL)
+			current_scope.erase(it->first);
+		else
+			current_scope[it->first] = it->second;
+	}
+	undo_log.clear();
+}
+
 // convert the AST into a simpler AST that has all parameters subsitited by their
 // values, unrolled for-loops, expanded generate blocks, etc. when this function
 // is done with an AST it can be converted into RTLIL using genRTLIL().
@@ -156,7 +179,7 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 	if (type == AST_PARAMETER || type == AST_LOCALPARAM || type == AST_DEFPARAM || type == AST_PARASET || type == AST_PREFIX)
 		in_param = true;
 
-	std::map<std::string, AstNode*> backup_scope;
+	scope_undo_log_t scope_undo_log;
 
 	// create name resolution entries for all objects with names
 	// also merge multiple declarations for the same wire (e.g. "output foobar; reg foobar;")
@@ -214,10 +237,8 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 				this_wire_scope[node->str] = node;
 			}
 			if (node->type == AST_PARAMETER || node->type == AST_LOCALPARAM || node->type == AST_WIRE || node->type == AST_AUTOWIRE || node->type == AST_GENVAR ||
-					node->type == AST_MEMORY || node->type == AST_FUNCTION || node->type == AST_TASK || node->type == AST_CELL) {
-				backup_scope[node->str] = current_scope[node->str];
-				current_scope[node->str] = node;
-			}
+					node->type == AST_MEMORY || node->type == AST_FUNCTION || node->type == AST_TASK || node->type == AST_CELL)
+				bind_scope(scope_undo_log, node->str, node);
 		}
 		for (size_t i = 0; i < children.size(); i++) {
 			AstNode *node = children[i];
@@ -415,12 +436,7 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 	current_block_child = backup_current_block_child;
 	current_top_block = backup_current_top_block;
 
-	for (auto it = backup_scope.begin(); it != backup_scope.end(); it++) {
-		if (it->second == NULL)
-			current_scope.erase(it->first);
-		else
-			current_scope[it->first] = it->second;
-	}
+	restore_scope(scope_undo_log);
 
 	current_filename = filename;
 	set_line_num(linenum);
@@ -648,15 +664,12 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 		varbuf = new AstNode(AST_LOCALPARAM, varbuf);
 		varbuf->str = init_ast->children[0]->str;
 
-		AstNode *backup_scope_varbuf = current_scope[varbuf->str];
-		current_scope[varbuf->str] = varbuf;
+		scope_undo_log_t varbuf_undo_log;
+		bind_scope(varbuf_undo_log, varbuf->str, varbuf);
 
-		size_t current_block_idx = 0;
-		if (type == AST_FOR) {
-			while (current_block_idx < current_block->children.size() &&
-					current_block->children[current_block_idx] != current_block_child)
-				current_block_idx++;
-		}
+		// statements from unrolling a for-loop are collected here and inserted
+		// into the current block in one go after the last iteration
+		std::vector<AstNode*> unrolled_stmts;
 
 		while (1)
 		{
@@ -694,10 +707,8 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 					buf->children[i]->simplify(false, false, false, stage, -1, false, false);
 					current_ast_mod->children.push_back(buf->children[i]);
 				}
-			} else {
-				for (size_t i = 0; i < buf->children.size(); i++)
-					current_block->children.insert(current_block->children.begin() + current_block_idx++, buf->children[i]);
-			}
+			} else
+				unrolled_stmts.insert(unrolled_stmts.end(), buf->children.begin(), buf->children.end());
 			buf->children.clear();
 			delete buf;
 
@@ -712,7 +723,16 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 			varbuf->children[0] = buf;
 		}
 
-		current_scope[varbuf->str] = backup_scope_varbuf;
+		if (type == AST_FOR) {
+			size_t current_block_idx = 0;
+			while (current_block_idx < current_block->children.size() &&
+					current_block->children[current_block_idx] != current_block_child)
+				current_block_idx++;
+			current_block->children.insert(current_block->children.begin() + current_block_idx,
+					unrolled_stmts.begin(), unrolled_stmts.end());
+		}
+
+		restore_scope(varbuf_undo_log);
 		delete varbuf;
 		delete_children();
 		did_something = true;
@@ -1207,6 +1227,7 @@ skip_dynamic_range_lvalue_expansion:;
 
 		size_t arg_count = 0;
 		std::map<std::string, std::string> replace_rules;
+		std::vector<AstNode*> new_stmts;
 
 		if (current_block == NULL)
 		{
@@ -1255,30 +1276,24 @@ skip_dynamic_range_lvalue_expansion:;
 					AstNode *arg = children[arg_count++]->clone();
 					AstNode *wire_id = new AstNode(AST_IDENTIFIER);
 					wire_id->str = wire->str;
-					AstNode *assign = new AstNode(AST_ASSIGN_EQ, wire_id, arg);
-
-					for (auto it = current_block->children.begin(); it != current_block->children.end(); it++) {
-						if (*it != current_block_child)
-							continue;
-						current_block->children.insert(it, assign);
-						break;
-					}
+					new_stmts.push_back(new AstNode(AST_ASSIGN_EQ, wire_id, arg));
 				}
 			}
 			else
 			{
 				AstNode *stmt = child->clone();
 				stmt->replace_ids(replace_rules);
-
-				for (auto it = current_block->children.begin(); it != current_block->children.end(); it++) {
-					if (*it != current_block_child)
-						continue;
-					current_block->children.insert(it, stmt);
-					break;
-				}
+				new_stmts.push_back(stmt);
 			}
 		}
 
+		for (auto it = current_block->children.begin(); it != current_block->children.end(); it++) {
+			if (*it != current_block_child)
+				continue;
+			current_block->children.insert(it, new_stmts.begin(), new_stmts.end());
+			break;
+		}
+
 	replace_fcall_with_id:
 		if (type == AST_FCALL) {
 			delete_children();
@@ -1494,7 +1509,7 @@ static void replace_result_wire_name_in_function(AstNode *node, std::string &fro
 }
 
 // annotate the names of all wires and other named objects in a generate block
-void AstNode::expand_genblock(std::string index_var, std::string prefix, std::map<std::string, std::string> &name_map)
+void AstNode::expand_genblock(const std::string &index_var, const std::string &prefix, std::map<std::string, std::string> &name_map)
 {
 	if (!index_var.empty() && type == AST_IDENTIFIER && str == index_var) {
 		current_scope[index_var]->children[0]->cloneInto(this);
@@ -1504,14 +1519,16 @@ void AstNode::expand_genblock(std::string index_var, std::string prefix, std::ma
 	if ((type == AST_IDENTIFIER || type == AST_FCALL || type == AST_TCALL) && name_map.count(str) > 0)
 		str = name_map[str];
 
-	std::map<std::string, std::string> backup_name_map;
+	// old entries of name_map that are shadowed by declarations in this block
+	// (an empty old name means that there was no entry for this name before)
+	std::vector<std::pair<std::string, std::string>> name_map_undo_log;
 
 	for (size_t i = 0; i < children.size(); i++) {
 		AstNode *child = children[i];
 		if (child->type == AST_WIRE || child->type == AST_MEMORY || child->type == AST_PARAMETER || child->type == AST_LOCALPARAM ||
 				child->type == AST_FUNCTION || child->type == AST_TASK || child->type == AST_CELL) {
-			if (backup_name_map.size() == 0)
-				backup_name_map = name_map;
+			std::string &slot = name_map[child->str];
+			name_map_undo_log.push_back(std::pair<std::string, std::string>(child->str, slot));
 			std::string new_name = prefix[0] == '\\' ? prefix.substr(1) : prefix;
 			size_t pos = child->str.rfind('.');
 			if (pos == std::string::npos)
@@ -1521,7 +1538,7 @@ void AstNode::expand_genblock(std::string index_var, std::string prefix, std::ma
 			new_name = child->str.substr(0, pos) + new_name + child->str.substr(pos);
 			if (new_name[0] != '$' && new_name[0] != '\\')
 				new_name = prefix[0] + new_name;
-			name_map[child->str] = new_name;
+			slot = new_name;
 			if (child->type == AST_FUNCTION)
 				replace_result_wire_name_in_function(child, child->str, new_name);
 			else
@@ -1536,8 +1553,12 @@ void AstNode::expand_genblock(std::string index_var, std::string prefix, std::ma
 			child->expand_genblock(index_var, prefix, name_map);
 	}
 
-	if (backup_name_map.size() > 0)
-		name_map.swap(backup_name_map);
+	for (auto it = name_map_undo_log.rbegin(); it != name_map_undo_log.rend(); it++) {
+		if (it->second.empty())
+			name_map.erase(it->first);
+		else
+			name_map[it->first] = it->second;
+	}
 }
 
 // rename stuff (used when tasks of functions are instanciated)
@@ -1848,7 +1869,7 @@ void AstNode::replace_variables(std::map<std::string, AstNode::varinfo_t> &varia
 // evaluate functions with all-const arguments
 AstNode *AstNode::eval_const_function(AstNode *fcall)
 {
-	std::map<std::string, AstNode*> backup_scope;
+	scope_undo_log_t scope_undo_log;
 	std::map<std::string, AstNode::varinfo_t> variables;
 	AstNode *block = NULL;
 
@@ -1873,8 +1894,7 @@ AstNode *AstNode::eval_const_function(AstNode *fcall)
 			variables[child->str].is_signed = child->is_signed;
 			if (child->is_input && argidx < fcall->children.size())
 				variables[child->str].val = fcall->children.at(argidx++)->bitsAsConst(variables[child->str].val.bits.size());
-			backup_scope[child->str] = current_scope[child->str];
-			current_scope[child->str] = child;
+			bind_scope(scope_undo_log, child->str, child);
 			continue;
 		}
 
@@ -2011,11 +2031,7 @@ AstNode *AstNode::eval_const_function(AstNode *fcall)
 		log_abort();
 	}
 
-	for (auto &it : backup_scope)
-		if (it.second == NULL)
-			current_scope.erase(it.first);
-		else
-			current_scope[it.first] = it.second;
+	restore_scope(scope_undo_log);
 
 	return AstNode::mkconst_bits(variables.at(str).val.bits, variables.at(str).is_signed);
 }
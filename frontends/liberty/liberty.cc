@@ -507,10 +507,13 @@ struct LibertyFrontend : public Frontend {
 		}
 		extra_args(f, filename, args, argidx);
 
-		LibertyParser parser(f);
+		LibertyAst *libast = liberty_cache_parse(f, filename);
 		int cell_count = 0;
 
-		for (auto cell : parser.ast->children)
+		if (libast == NULL)
+			log_error("No library definition found in liberty file `%s'.\n", filename.c_str());
+
+		for (auto cell : libast->children)
 		{
 			if (cell->id != "cell" || cell->args.size() != 1)
 				continue;
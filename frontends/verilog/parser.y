@@ -28,8 +28,8 @@
  *
  *  This is the actual bison parser for Verilog code. The AST ist created directly
  *  from the bison reduce functions here. Note that this code uses a few global
- *  variables to hold the state of the AST generator and therefore this parser is
- *  not reentrant.
+ *  variables to hold the state of the AST generator. They are thread-local, so
+ *  different threads can run the parser concurrently on different files.
  *
  */
 
@@ -43,17 +43,17 @@ using namespace AST;
 using namespace VERILOG_FRONTEND;
 
 namespace VERILOG_FRONTEND {
-	int port_counter;
-	std::map<std::string, int> port_stubs;
-	std::map<std::string, AstNode*> attr_list, default_attr_list;
-	std::map<std::string, AstNode*> *albuf;
-	std::vector<AstNode*> ast_stack;
-	struct AstNode *astbuf1, *astbuf2, *astbuf3;
-	struct AstNode *current_function_or_task;
-	struct AstNode *current_ast, *current_ast_mod;
-	int current_function_or_task_port_id;
-	std::vector<char> case_type_stack;
-	bool default_nettype_wire;
+	thread_local int port_counter;
+	thread_local std::map<std::string, int> port_stubs;
+	thread_local std::map<std::string, AstNode*> attr_list, default_attr_list;
+	thread_local std::map<std::string, AstNode*> *albuf;
+	thread_local std::vector<AstNode*> ast_stack;
+	thread_local struct AstNode *astbuf1, *astbuf2, *astbuf3;
+	thread_local struct AstNode *current_function_or_task;
+	thread_local struct AstNode *current_ast, *current_ast_mod;
+	thread_local int current_function_or_task_port_id;
+	thread_local std::vector<char> case_type_stack;
+	thread_local bool default_nettype_wire;
 }
 
 static void append_attr(AstNode *ast, std::map<std::string, AstNode*> *al)
@@ -85,6 +85,7 @@ static void free_attr(std::map<std::string, AstNode*> *al)
 %}
 
 %name-prefix "frontend_verilog_yy"
+%define api.pure
 
 %union {
 	std::string *string;
@@ -93,6 +94,11 @@ static void free_attr(std::map<std::string, AstNode*> *al)
 	bool boolean;
 }
 
+%{
+// implemented in lexer.l
+int frontend_verilog_yylex(YYSTYPE *yylval_param);
+%}
+
 %token <string> TOK_STRING TOK_ID TOK_CONST TOK_PRIMITIVE
 %token ATTR_BEGIN ATTR_END DEFATTR_BEGIN DEFATTR_END
 %token TOK_MODULE TOK_ENDMODULE TOK_PARAMETER TOK_LOCALPARAM TOK_DEFPARAM
@@ -38,42 +38,66 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
-
-static std::list<std::string> output_code;
-static std::list<std::string> input_buffer;
-static size_t input_buffer_charp;
+#include <sys/stat.h>
+#include <mutex>
+
+// The input is kept as a stack of input frames. The bottom frame holds the
+// contents of the main file, each `include and each macro expansion pushes a
+// new frame on top of it. Characters are read from the top-most frame that
+// is not exhausted yet, so inserting text never copies the remaining input.
+
+struct PreprocInputFrame {
+	std::string data;
+	size_t charp;
+	PreprocInputFrame(const std::string &data) : data(data), charp(0) { }
+};
+
+static thread_local std::string output_code;
+static thread_local std::vector<PreprocInputFrame> input_stack;
+
+// the raw contents of include files, shared between all read_verilog calls
+struct PreprocCachedFile {
+	time_t mtime;
+	off_t size;
+	std::string data;
+};
+static std::map<std::string, PreprocCachedFile> include_cache;
+static std::mutex include_cache_mutex;
+
+static bool input_empty()
+{
+	while (!input_stack.empty() && input_stack.back().charp == input_stack.back().data.size())
+		input_stack.pop_back();
+	return input_stack.empty();
+}
 
 static void return_char(char ch)
 {
-	if (input_buffer_charp == 0)
-		input_buffer.push_front(std::string() + ch);
-	else
-		input_buffer.front()[--input_buffer_charp] = ch;
+	if (!input_stack.empty()) {
+		PreprocInputFrame &frame = input_stack.back();
+		if (frame.charp > 0 && frame.data[frame.charp-1] == ch) {
+			frame.charp--;
+			return;
+		}
+	}
+	input_stack.push_back(PreprocInputFrame(std::string(1, ch)));
 }
 
-static void insert_input(std::string str)
+static void insert_input(const std::string &str)
 {
-	if (input_buffer_charp != 0) {
-		input_buffer.front() = input_buffer.front().substr(input_buffer_charp);
-		input_buffer_charp = 0;
-	}
-	input_buffer.push_front(str);
+	if (!str.empty())
+		input_stack.push_back(PreprocInputFrame(str));
 }
 
 static char next_char()
 {
-	if (input_buffer.empty())
-		return 0;
-
-	assert(input_buffer_charp <= input_buffer.front().size());
-	if (input_buffer_charp == input_buffer.front().size()) {
-		input_buffer_charp = 0;
-		input_buffer.pop_front();
-		return next_char();
+	while (!input_empty()) {
+		PreprocInputFrame &frame = input_stack.back();
+		char ch = frame.data[frame.charp++];
+		if (ch != '\r')
+			return ch;
 	}
-
-	char ch = input_buffer.front()[input_buffer_charp++];
-	return ch == '\r' ? next_char() : ch;
+	return 0;
 }
 
 static std::string skip_spaces()
@@ -103,7 +127,7 @@ static std::string next_token(bool pass_newline = false)
 	token += ch;
 	if (ch == '\n') {
 		if (pass_newline) {
-			output_code.push_back(token);
+			output_code += token;
 			return "";
 		}
 		return token;
@@ -172,10 +196,23 @@ static std::string next_token(bool pass_newline = false)
 	}
 	else
 	{
-		const char *ok = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ$0123456789";
-		if (ch == '`' || strchr(ok, ch) != NULL)
-			while ((ch = next_char()) != 0) {
-				if (strchr(ok, ch) == NULL) {
+		static bool ok[256];
+		if (!ok[(unsigned char)'_'])
+			for (const char *p = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ$0123456789"; *p; p++)
+				ok[(unsigned char)*p] = true;
+		if (ch == '`' || ok[(unsigned char)ch])
+			while (1) {
+				// fast path: copy the identifier characters from the current input frame
+				if (!input_empty()) {
+					PreprocInputFrame &frame = input_stack.back();
+					size_t begin = frame.charp;
+					while (frame.charp < frame.data.size() && ok[(unsigned char)frame.data[frame.charp]])
+						frame.charp++;
+					token.append(frame.data, begin, frame.charp - begin);
+				}
+				if ((ch = next_char()) == 0)
+					break;
+				if (!ok[(unsigned char)ch]) {
 					return_char(ch);
 					break;
 				}
@@ -186,20 +223,49 @@ static std::string next_token(bool pass_newline = false)
 	return token;
 }
 
-static void input_file(FILE *f, std::string filename)
+static void input_file(const std::string &data, std::string filename)
+{
+	insert_input("`file_pop\n");
+	insert_input(data);
+	insert_input("`file_push " + filename + "\n");
+}
+
+static std::string read_file(FILE *f)
 {
-	char buffer[513];
-	int rc;
+	std::string data;
+	char buffer[65536];
+	size_t rc;
+
+	while ((rc = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		data.append(buffer, rc);
+	return data;
+}
 
-	insert_input("");
-	auto it = input_buffer.begin();
+static bool read_include_file(const std::string &fn, std::string &data)
+{
+	struct stat st;
+	if (stat(fn.c_str(), &st) != 0 || S_ISDIR(st.st_mode))
+		return false;
 
-	input_buffer.insert(it, "`file_push " + filename + "\n");
-	while ((rc = fread(buffer, 1, sizeof(buffer)-1, f)) > 0) {
-		buffer[rc] = 0;
-		input_buffer.insert(it, buffer);
+	std::lock_guard<std::mutex> lock(include_cache_mutex);
+
+	auto it = include_cache.find(fn);
+	if (it != include_cache.end() && it->second.mtime == st.st_mtime && it->second.size == st.st_size) {
+		data = it->second.data;
+		return true;
 	}
-	input_buffer.insert(it, "`file_pop\n");
+
+	FILE *fp = fopen(fn.c_str(), "r");
+	if (fp == NULL)
+		return false;
+	data = read_file(fp);
+	fclose(fp);
+
+	PreprocCachedFile &entry = include_cache[fn];
+	entry.mtime = st.st_mtime;
+	entry.size = st.st_size;
+	entry.data = data;
+	return true;
 }
 
 std::string frontend_verilog_preproc(FILE *f, std::string filename, const std::map<std::string, std::string> pre_defines_map, const std::list<std::string> include_dirs)
@@ -210,17 +276,26 @@ std::string frontend_verilog_preproc(FILE *f, std::string filename, const std::m
 	bool in_elseif = false;
 
 	output_code.clear();
-	input_buffer.clear();
-	input_buffer_charp = 0;
+	input_stack.clear();
 
-	input_file(f, filename);
+	std::string data = read_file(f);
+	output_code.reserve(data.size() + data.size() / 4);
+	input_file(data, filename);
 	defines_map["__YOSYS__"] = "1";
 
-	while (!input_buffer.empty())
+	while (!input_empty())
 	{
 		std::string tok = next_token();
 		// printf("token: >>%s<<\n", tok != "\n" ? tok.c_str() : "NEWLINE");
 
+		if (tok.empty() || tok[0] != '`') {
+			if (ifdef_fail_level == 0)
+				output_code += tok;
+			else if (tok == "\n")
+				output_code += tok;
+			continue;
+		}
+
 		if (tok == "`endif") {
 			if (ifdef_fail_level > 0)
 				ifdef_fail_level--;
@@ -265,7 +340,7 @@ std::string frontend_verilog_preproc(FILE *f, std::string filename, const std::m
 
 		if (ifdef_fail_level > 0) {
 			if (tok == "\n")
-				output_code.push_back(tok);
+				output_code += tok;
 			continue;
 		}
 
@@ -281,27 +356,27 @@ std::string frontend_verilog_preproc(FILE *f, std::string filename, const std::m
 				else
 					fn = fn.substr(0, pos) + fn.substr(pos+1);
 			}
-			FILE *fp = fopen(fn.c_str(), "r");
-			if (fp == NULL && fn.size() > 0 && fn[0] != '/' && filename.find('/') != std::string::npos) {
+			std::string data;
+			bool found = read_include_file(fn, data);
+			if (!found && fn.size() > 0 && fn[0] != '/' && filename.find('/') != std::string::npos) {
 				// if the include file was not found, it is not given with an absolute path, and the
 				// currently read file is given with a path, then try again relative to its directory
 				std::string fn2 = filename.substr(0, filename.rfind('/')+1) + fn;
-				fp = fopen(fn2.c_str(), "r");
+				found = read_include_file(fn2, data);
 			}
-			if (fp == NULL && fn.size() > 0 && fn[0] != '/') {
+			if (!found && fn.size() > 0 && fn[0] != '/') {
 				// if the include file was not found and it is not given with an absolute path, then
 				// search it in the include path
 				for (auto incdir : include_dirs) {
 					std::string fn2 = incdir + '/' + fn;
-					fp = fopen(fn2.c_str(), "r");
-					if (fp != NULL) break;
+					found = read_include_file(fn2, data);
+					if (found) break;
 				}
 			}
-			if (fp != NULL) {
-				input_file(fp, fn);
-				fclose(fp);
-			} else
-				output_code.push_back("`file_notfound " + fn + "\n");
+			if (found)
+				input_file(data, fn);
+			else
+				output_code += "`file_notfound " + fn + "\n";
 			continue;
 		}
 
@@ -414,16 +489,12 @@ std::string frontend_verilog_preproc(FILE *f, std::string filename, const std::m
 			continue;
 		}
 
-		output_code.push_back(tok);
+		output_code += tok;
 	}
 
 	std::string output;
-	for (auto &str : output_code)
-		output += str;
-
-	output_code.clear();
-	input_buffer.clear();
-	input_buffer_charp = 0;
+	output.swap(output_code);
+	input_stack.clear();
 
 	return output;
 }
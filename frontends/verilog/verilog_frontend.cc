@@ -33,7 +33,11 @@
 #include "libs/sha1/sha1.h"
 #include <sstream>
 #include <stdarg.h>
+#include <string.h>
+#include <errno.h>
 #include <assert.h>
+#include <atomic>
+#include <thread>
 
 using namespace VERILOG_FRONTEND;
 
@@ -42,6 +46,47 @@ using namespace VERILOG_FRONTEND;
 static std::vector<std::string> verilog_defaults;
 static std::list<std::vector<std::string>> verilog_defaults_stack;
 
+struct VerilogParseJob {
+	std::string filename;
+	FILE *f;
+	AST::AstNode *ast;
+	bool nettype_wire;
+	std::string error;
+};
+
+// run the preprocessor and the parser on a single file (may be called from worker threads)
+static void parse_verilog_file(VerilogParseJob &job, const std::map<std::string, std::string> &defines_map,
+		const std::list<std::string> &include_dirs, bool flag_nopp, bool flag_ppdump)
+{
+	AST::current_filename = job.filename;
+	AST::set_line_num = &frontend_verilog_yyset_lineno;
+	AST::get_line_num = &frontend_verilog_yyget_lineno;
+
+	current_ast = new AST::AstNode(AST::AST_DESIGN);
+	default_nettype_wire = true;
+
+	FILE *fp = job.f;
+	std::string code_after_preproc;
+
+	if (!flag_nopp) {
+		code_after_preproc = frontend_verilog_preproc(job.f, job.filename, defines_map, include_dirs);
+		if (flag_ppdump)
+			log("-- Verilog code after preprocessor --\n%s-- END OF DUMP --\n", code_after_preproc.c_str());
+		fp = fmemopen((void*)code_after_preproc.c_str(), code_after_preproc.size(), "r");
+	}
+
+	frontend_verilog_scanner_begin(fp);
+	frontend_verilog_yyparse();
+	frontend_verilog_scanner_end();
+
+	if (!flag_nopp)
+		fclose(fp);
+
+	job.ast = current_ast;
+	job.nettype_wire = default_nettype_wire;
+	current_ast = NULL;
+}
+
 struct VerilogFrontend : public Frontend {
 	VerilogFrontend() : Frontend("verilog", "read modules from verilog file") { }
 	virtual void help()
@@ -123,6 +168,11 @@ struct VerilogFrontend : public Frontend {
 		log("        add 'dir' to the directories which are used when searching include\n");
 		log("        files\n");
 		log("\n");
+		log("    -j <num_threads>\n");
+		log("        read all files given on the command line and preprocess and parse\n");
+		log("        them using the specified number of threads. The modules are added\n");
+		log("        to the design in the order in which the files are given.\n");
+		log("\n");
 		log("The command 'verilog_defaults' can be used to register default options for\n");
 		log("subsequent calls to 'read_verilog'.\n");
 		log("\n");
@@ -150,6 +200,7 @@ struct VerilogFrontend : public Frontend {
 		std::map<std::string, std::string> defines_map;
 		std::list<std::string> include_dirs;
 		std::list<std::string> attributes;
+		int num_threads = 0;
 		frontend_verilog_yydebug = false;
 
 		log_header("Executing Verilog-2005 frontend.\n");
@@ -246,48 +297,96 @@ struct VerilogFrontend : public Frontend {
 				include_dirs.push_back(arg.substr(2));
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_threads = atoi(args[++argidx].c_str());
+				if (num_threads < 1)
+					cmd_error(args, argidx, "Number of threads must be positive.");
+				continue;
+			}
 			break;
 		}
-		extra_args(f, filename, args, argidx);
 
-		log("Parsing Verilog input from `%s' to AST representation.\n", filename.c_str());
+		std::vector<VerilogParseJob> jobs;
+
+		if (num_threads > 0 && f == NULL)
+		{
+			for (; argidx < args.size(); argidx++) {
+				if (args[argidx].substr(0, 1) == "-")
+					cmd_error(args, argidx, "Unkown option or option in arguments.");
+				VerilogParseJob job;
+				job.filename = args[argidx];
+				job.f = fopen(job.filename.c_str(), "r");
+				job.ast = NULL;
+				if (job.f == NULL)
+					log_cmd_error("Can't open input file `%s' for reading: %s\n", job.filename.c_str(), strerror(errno));
+				jobs.push_back(job);
+			}
+			if (jobs.empty())
+				cmd_error(args, argidx, "No filename given.");
 
-		AST::current_filename = filename;
-		AST::set_line_num = &frontend_verilog_yyset_lineno;
-		AST::get_line_num = &frontend_verilog_yyget_lineno;
+			log("Parsing %d Verilog files to AST representation using %d threads.\n", int(jobs.size()), num_threads);
 
-		current_ast = new AST::AstNode(AST::AST_DESIGN);
-		default_nettype_wire = true;
+			// errors in the worker threads are reported by the main thread after all
+			// workers are finished. the parser state of a thread is undefined after
+			// an error, so the workers stop when any of them has found an error.
+			std::atomic<size_t> next_job(0);
+			std::atomic<bool> found_error(false);
+			std::vector<std::thread> workers;
+			for (int i = 0; i < num_threads && i < int(jobs.size()); i++)
+				workers.push_back(std::thread([&]() {
+					log_error_throw = true;
+					for (size_t idx = next_job++; idx < jobs.size() && !found_error; idx = next_job++)
+						try {
+							parse_verilog_file(jobs[idx], defines_map, include_dirs, flag_nopp, flag_ppdump);
+						} catch (std::string &message) {
+							jobs[idx].error = message;
+							found_error = true;
+						}
+				}));
+			for (auto &worker : workers)
+				worker.join();
 
-		FILE *fp = f;
-		std::string code_after_preproc;
+			for (auto &job : jobs)
+				fclose(job.f);
 
-		if (!flag_nopp) {
-			code_after_preproc = frontend_verilog_preproc(f, filename, defines_map, include_dirs);
-			if (flag_ppdump)
-				log("-- Verilog code after preprocessor --\n%s-- END OF DUMP --\n", code_after_preproc.c_str());
-			fp = fmemopen((void*)code_after_preproc.c_str(), code_after_preproc.size(), "r");
+			for (auto &job : jobs)
+				if (!job.error.empty())
+					log_error("%s", job.error.c_str());
 		}
+		else
+		{
+			extra_args(f, filename, args, argidx);
 
-		frontend_verilog_yyset_lineno(1);
-		frontend_verilog_yyrestart(fp);
-		frontend_verilog_yyparse();
-		frontend_verilog_yylex_destroy();
+			log("Parsing Verilog input from `%s' to AST representation.\n", filename.c_str());
 
-		for (auto &child : current_ast->children) {
-			log_assert(child->type == AST::AST_MODULE);
-			for (auto &attr : attributes)
-				if (child->attributes.count(attr) == 0)
-					child->attributes[attr] = AST::AstNode::mkconst_int(1, false);
+			VerilogParseJob job;
+			job.filename = filename;
+			job.f = f;
+			job.ast = NULL;
+			parse_verilog_file(job, defines_map, include_dirs, flag_nopp, flag_ppdump);
+			jobs.push_back(job);
 		}
 
-		AST::process(design, current_ast, flag_dump_ast1, flag_dump_ast2, flag_dump_vlog, flag_nolatches, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_ignore_redef, flag_defer, default_nettype_wire);
+		for (auto &job : jobs)
+		{
+			if (jobs.size() > 1)
+				log("Generating RTLIL representation for `%s'.\n", job.filename.c_str());
+
+			for (auto &child : job.ast->children) {
+				log_assert(child->type == AST::AST_MODULE);
+				for (auto &attr : attributes)
+					if (child->attributes.count(attr) == 0)
+						child->attributes[attr] = AST::AstNode::mkconst_int(1, false);
+			}
 
-		if (!flag_nopp)
-			fclose(fp);
+			AST::current_filename = job.filename;
+			AST::set_line_num = &frontend_verilog_yyset_lineno;
+			AST::get_line_num = &frontend_verilog_yyget_lineno;
 
-		delete current_ast;
-		current_ast = NULL;
+			AST::process(design, job.ast, flag_dump_ast1, flag_dump_ast2, flag_dump_vlog, flag_nolatches, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_ignore_redef, flag_defer, job.nettype_wire);
+
+			delete job.ast;
+		}
 
 		log("Successfully finished Verilog frontend.\n");
 	}
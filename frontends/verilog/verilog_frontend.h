@@ -38,26 +38,28 @@
 namespace VERILOG_FRONTEND
 {
 	// this variable is set to a new AST_DESIGN node and then filled with the AST by the bison parser
-	extern struct AST::AstNode *current_ast;
+	extern thread_local struct AST::AstNode *current_ast;
 
 	// this function converts a Verilog constant to an AST_CONSTANT node
 	AST::AstNode *const2ast(std::string code, char case_type = 0);
 
 	// state of `default_nettype
-	extern bool default_nettype_wire;
+	extern thread_local bool default_nettype_wire;
 }
 
 // the pre-processor
 std::string frontend_verilog_preproc(FILE *f, std::string filename, const std::map<std::string, std::string> pre_defines_map, const std::list<std::string> include_dirs);
 
-// the usual bison/flex stuff
+// the usual bison/flex stuff (the scanner is reentrant and the parser is pure, all
+// other parser state is thread-local, so multiple files can be parsed in parallel)
 extern int frontend_verilog_yydebug;
-int frontend_verilog_yylex(void);
 void frontend_verilog_yyerror(char const *fmt, ...);
-void frontend_verilog_yyrestart(FILE *f);
 int frontend_verilog_yyparse(void);
-int frontend_verilog_yylex_destroy(void);
 int frontend_verilog_yyget_lineno(void);
 void frontend_verilog_yyset_lineno (int);
 
+// create and destroy the scanner instance for the current thread
+void frontend_verilog_scanner_begin(FILE *f);
+void frontend_verilog_scanner_end();
+
 #endif
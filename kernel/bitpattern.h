@@ -23,40 +23,50 @@
 #include "kernel/log.h"
 #include "kernel/rtlil.h"
 
+// A pool of bit patterns, stored as a list of disjoint cubes. Each cube is
+// packed into 64 bit words: a care mask followed by the values of the bits
+// that are set in the care mask (the other value bits are always zero).
+
 struct BitPatternPool
 {
-	int width;
-	typedef std::vector<RTLIL::State> bits_t;
-	std::set<bits_t> pool;
+	int width, words;
+	typedef std::vector<uint64_t> bits_t;
+	std::vector<bits_t> pool;
 
 	BitPatternPool(RTLIL::SigSpec sig)
 	{
 		width = sig.width;
+		words = (width + 63) / 64;
 		if (width > 0) {
-			std::vector<RTLIL::State> pattern(width);
+			bits_t pattern(2*words);
 			sig.optimize();
 			for (int i = 0; i < width; i++) {
 				RTLIL::SigSpec s = sig.extract(i, 1);
 				s.optimize();
 				assert(s.chunks.size() == 1);
 				if (s.chunks[0].wire == NULL && s.chunks[0].data.bits[0] <= RTLIL::State::S1)
-					pattern[i] = s.chunks[0].data.bits[0];
-				else
-					pattern[i] = RTLIL::State::Sa;
+					set_bit(pattern, i, s.chunks[0].data.bits[0] == RTLIL::State::S1);
 			}
-			pool.insert(pattern);
+			pool.push_back(pattern);
 		}
 	}
 
 	BitPatternPool(int width)
 	{
 		this->width = width;
-		if (width > 0) {
-			std::vector<RTLIL::State> pattern(width);
-			for (int i = 0; i < width; i++)
-				pattern[i] = RTLIL::State::Sa;
-			pool.insert(pattern);
-		}
+		words = (width + 63) / 64;
+		if (width > 0)
+			pool.push_back(bits_t(2*words));
+	}
+
+	void set_bit(bits_t &bits, int i, bool value)
+	{
+		uint64_t mask = uint64_t(1) << (i % 64);
+		bits[i / 64] |= mask;
+		if (value)
+			bits[words + i / 64] |= mask;
+		else
+			bits[words + i / 64] &= ~mask;
 	}
 
 	bits_t sig2bits(RTLIL::SigSpec sig)
@@ -64,23 +74,49 @@ struct BitPatternPool
 		sig.optimize();
 		assert(sig.is_fully_const());
 		assert(sig.chunks.size() == 1);
-		bits_t bits = sig.chunks[0].data.bits;
-		for (auto &b : bits)
-			if (b > RTLIL::State::S1)
-				b = RTLIL::State::Sa;
+		assert(int(sig.chunks[0].data.bits.size()) == width);
+		bits_t bits(2*words);
+		for (int i = 0; i < width; i++)
+			if (sig.chunks[0].data.bits[i] <= RTLIL::State::S1)
+				set_bit(bits, i, sig.chunks[0].data.bits[i] == RTLIL::State::S1);
 		return bits;
 	}
 
-	bool match(bits_t a, bits_t b)
+	// the cubes a and b have at least one pattern in common
+	bool match(const bits_t &a, const bits_t &b)
 	{
-		assert(int(a.size()) == width);
-		assert(int(b.size()) == width);
-		for (int i = 0; i < width; i++)
-			if (a[i] <= RTLIL::State::S1 && b[i] <= RTLIL::State::S1 && a[i] != b[i])
+		for (int i = 0; i < words; i++)
+			if ((a[i] & b[i] & (a[words+i] ^ b[words+i])) != 0)
+				return false;
+		return true;
+	}
+
+	// all patterns of cube b are in cube a
+	bool contains(const bits_t &a, const bits_t &b)
+	{
+		for (int i = 0; i < words; i++)
+			if ((a[i] & ~b[i]) != 0 || (a[i] & (a[words+i] ^ b[words+i])) != 0)
 				return false;
 		return true;
 	}
 
+	// append the patterns of cube a that are not in cube b to the list
+	// as disjoint cubes (a and b must match)
+	void sharp(bits_t a, const bits_t &b, std::vector<bits_t> &result)
+	{
+		for (int i = 0; i < words; i++) {
+			uint64_t free_bits = b[i] & ~a[i];
+			for (int j = 0; free_bits != 0; j++, free_bits >>= 1) {
+				if ((free_bits & 1) == 0)
+					continue;
+				bool value = (b[words+i] >> j) & 1;
+				set_bit(a, 64*i + j, !value);
+				result.push_back(a);
+				set_bit(a, 64*i + j, value);
+			}
+		}
+	}
+
 	bool has_any(RTLIL::SigSpec sig)
 	{
 		bits_t bits = sig2bits(sig);
@@ -94,13 +130,24 @@ struct BitPatternPool
 	{
 		bits_t bits = sig2bits(sig);
 		for (auto &it : pool)
-			if (match(it, bits)) {
-				for (int i = 0; i < width; i++)
-					if (bits[i] > RTLIL::State::S1 && it[i] <= RTLIL::State::S1)
-						goto next_pool_entry;
+			if (contains(it, bits))
 				return true;
-	next_pool_entry:;
-			}
+
+		// remove the cubes of the pool from the pattern, the pattern is
+		// covered by the pool if nothing is left
+		std::vector<bits_t> rest;
+		rest.push_back(bits);
+		for (auto &it : pool) {
+			std::vector<bits_t> new_rest;
+			for (auto &r : rest)
+				if (match(r, it))
+					sharp(r, it, new_rest);
+				else
+					new_rest.push_back(r);
+			rest.swap(new_rest);
+			if (rest.empty())
+				return true;
+		}
 		return false;
 	}
 
@@ -108,21 +155,14 @@ struct BitPatternPool
 	{
 		bool status = false;
 		bits_t bits = sig2bits(sig);
-		std::vector<bits_t> pattern_list;
+		std::vector<bits_t> new_pool;
 		for (auto &it : pool)
-			if (match(it, bits))
-				pattern_list.push_back(it);
-		for (auto pattern : pattern_list) {
-			pool.erase(pattern);
-			for (int i = 0; i < width; i++) {
-				if (pattern[i] != RTLIL::State::Sa || bits[i] == RTLIL::State::Sa)
-					continue;
-				bits_t new_pattern = pattern;
-				new_pattern[i] = bits[i] == RTLIL::State::S1 ? RTLIL::State::S0 : RTLIL::State::S1;
-				pool.insert(new_pattern);
-			}
-			status = true;
-		}
+			if (match(it, bits)) {
+				sharp(it, bits, new_pool);
+				status = true;
+			} else
+				new_pool.push_back(it);
+		pool.swap(new_pool);
 		return status;
 	}
 
@@ -138,6 +178,6 @@ struct BitPatternPool
 	{
 		return pool.empty();
 	}
-}; 
+};
 
 #endif
@@ -27,9 +27,24 @@
 #include <kernel/rtlil.h>
 #include <kernel/log.h>
 
+// A resolved cell type: the port directions and the properties of the cell
+// type are looked up once when the type is registered, so that the queries
+// below are a single map lookup and do not need to compare port names.
+struct CellType
+{
+	typedef RTLIL::Const (*eval_func_t)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int);
+
+	std::string type;
+	std::set<std::string> inputs, outputs;
+	eval_func_t eval_func;
+	bool is_commutative;
+
+	CellType() : eval_func(NULL), is_commutative(false) { }
+};
+
 struct CellTypes
 {
-	std::set<std::string> cell_types;
+	std::map<std::string, CellType> cell_types;
 	std::vector<const RTLIL::Design*> designs;
 
 	CellTypes()
@@ -51,6 +66,20 @@ struct CellTypes
 		setup_stdcells_mem();
 	}
 
+	CellType &setup_type(std::string type, const std::vector<std::string> &inputs, const std::vector<std::string> &outputs,
+			CellType::eval_func_t eval_func = NULL, bool is_commutative = false)
+	{
+		CellType &ct = cell_types[type];
+		ct.type = type;
+		ct.inputs = std::set<std::string>(inputs.begin(), inputs.end());
+		ct.outputs = std::set<std::string>(outputs.begin(), outputs.end());
+		ct.eval_func = eval_func;
+		ct.is_commutative = is_commutative;
+		return ct;
+	}
+
+	// The modules of the design are looked up when a cell type is queried,
+	// so modules and ports that are added later are known as well.
 	void setup_design(const RTLIL::Design *design)
 	{
 		designs.push_back(design);
@@ -58,106 +87,102 @@ struct CellTypes
 
 	void setup_internals()
 	{
-		cell_types.insert("$not");
-		cell_types.insert("$pos");
-		cell_types.insert("$bu0");
-		cell_types.insert("$neg");
-		cell_types.insert("$and");
-		cell_types.insert("$or");
-		cell_types.insert("$xor");
-		cell_types.insert("$xnor");
-		cell_types.insert("$reduce_and");
-		cell_types.insert("$reduce_or");
-		cell_types.insert("$reduce_xor");
-		cell_types.insert("$reduce_xnor");
-		cell_types.insert("$reduce_bool");
-		cell_types.insert("$shl");
-		cell_types.insert("$shr");
-		cell_types.insert("$sshl");
-		cell_types.insert("$sshr");
-		cell_types.insert("$lt");
-		cell_types.insert("$le");
-		cell_types.insert("$eq");
-		cell_types.insert("$ne");
-		cell_types.insert("$eqx");
-		cell_types.insert("$nex");
-		cell_types.insert("$ge");
-		cell_types.insert("$gt");
-		cell_types.insert("$add");
-		cell_types.insert("$sub");
-		cell_types.insert("$mul");
-		cell_types.insert("$div");
-		cell_types.insert("$mod");
-		cell_types.insert("$pow");
-		cell_types.insert("$logic_not");
-		cell_types.insert("$logic_and");
-		cell_types.insert("$logic_or");
-		cell_types.insert("$mux");
-		cell_types.insert("$pmux");
-		cell_types.insert("$slice");
-		cell_types.insert("$concat");
-		cell_types.insert("$safe_pmux");
-		cell_types.insert("$lut");
-		cell_types.insert("$assert");
+		std::vector<std::string> unary_ops = { "\\A" }, binary_ops = { "\\A", "\\B" }, y = { "\\Y" };
+
+		setup_type("$not", unary_ops, y, RTLIL::const_not);
+		setup_type("$pos", unary_ops, y, RTLIL::const_pos);
+		setup_type("$bu0", unary_ops, y, RTLIL::const_bu0);
+		setup_type("$neg", unary_ops, y, RTLIL::const_neg);
+		setup_type("$and", binary_ops, y, RTLIL::const_and, true);
+		setup_type("$or", binary_ops, y, RTLIL::const_or, true);
+		setup_type("$xor", binary_ops, y, RTLIL::const_xor, true);
+		setup_type("$xnor", binary_ops, y, RTLIL::const_xnor, true);
+		setup_type("$reduce_and", unary_ops, y, RTLIL::const_reduce_and);
+		setup_type("$reduce_or", unary_ops, y, RTLIL::const_reduce_or);
+		setup_type("$reduce_xor", unary_ops, y, RTLIL::const_reduce_xor);
+		setup_type("$reduce_xnor", unary_ops, y, RTLIL::const_reduce_xnor);
+		setup_type("$reduce_bool", unary_ops, y, RTLIL::const_reduce_bool);
+		setup_type("$shl", binary_ops, y, RTLIL::const_shl);
+		setup_type("$shr", binary_ops, y, RTLIL::const_shr);
+		setup_type("$sshl", binary_ops, y, RTLIL::const_sshl);
+		setup_type("$sshr", binary_ops, y, RTLIL::const_sshr);
+		setup_type("$lt", binary_ops, y, RTLIL::const_lt);
+		setup_type("$le", binary_ops, y, RTLIL::const_le);
+		setup_type("$eq", binary_ops, y, RTLIL::const_eq);
+		setup_type("$ne", binary_ops, y, RTLIL::const_ne);
+		setup_type("$eqx", binary_ops, y, RTLIL::const_eqx);
+		setup_type("$nex", binary_ops, y, RTLIL::const_nex);
+		setup_type("$ge", binary_ops, y, RTLIL::const_ge);
+		setup_type("$gt", binary_ops, y, RTLIL::const_gt);
+		setup_type("$add", binary_ops, y, RTLIL::const_add, true);
+		setup_type("$sub", binary_ops, y, RTLIL::const_sub);
+		setup_type("$mul", binary_ops, y, RTLIL::const_mul, true);
+		setup_type("$div", binary_ops, y, RTLIL::const_div);
+		setup_type("$mod", binary_ops, y, RTLIL::const_mod);
+		setup_type("$pow", binary_ops, y, RTLIL::const_pow);
+		setup_type("$logic_not", unary_ops, y, RTLIL::const_logic_not);
+		setup_type("$logic_and", binary_ops, y, RTLIL::const_logic_and, true);
+		setup_type("$logic_or", binary_ops, y, RTLIL::const_logic_or, true);
+		setup_type("$mux", { "\\A", "\\B", "\\S" }, y);
+		setup_type("$pmux", { "\\A", "\\B", "\\S" }, y);
+		setup_type("$slice", unary_ops, y);
+		setup_type("$concat", binary_ops, y);
+		setup_type("$safe_pmux", { "\\A", "\\B", "\\S" }, y);
+		setup_type("$lut", { "\\I" }, { "\\O" });
+		setup_type("$assert", { "\\A", "\\EN" }, { });
 	}
 
 	void setup_internals_mem()
 	{
-		cell_types.insert("$sr");
-		cell_types.insert("$dff");
-		cell_types.insert("$dffsr");
-		cell_types.insert("$adff");
-		cell_types.insert("$dlatch");
-		cell_types.insert("$dlatchsr");
-		cell_types.insert("$memrd");
-		cell_types.insert("$memwr");
-		cell_types.insert("$mem");
-		cell_types.insert("$fsm");
+		setup_type("$sr", { "\\SET", "\\CLR" }, { "\\Q" });
+		setup_type("$dff", { "\\CLK", "\\D" }, { "\\Q" });
+		setup_type("$dffsr", { "\\CLK", "\\SET", "\\CLR", "\\D" }, { "\\Q" });
+		setup_type("$adff", { "\\CLK", "\\ARST", "\\D" }, { "\\Q" });
+		setup_type("$dlatch", { "\\EN", "\\D" }, { "\\Q" });
+		setup_type("$dlatchsr", { "\\EN", "\\SET", "\\CLR", "\\D" }, { "\\Q" });
+		setup_type("$memrd", { "\\CLK", "\\ADDR" }, { "\\DATA" });
+		setup_type("$memwr", { "\\CLK", "\\EN", "\\ADDR", "\\DATA" }, { });
+		setup_type("$mem", { "\\RD_CLK", "\\RD_ADDR", "\\WR_CLK", "\\WR_EN", "\\WR_ADDR", "\\WR_DATA" }, { "\\RD_DATA" });
+		setup_type("$fsm", { "\\CLK", "\\ARST", "\\CTRL_IN" }, { "\\CTRL_OUT" });
 	}
 
 	void setup_stdcells()
 	{
-		cell_types.insert("$_INV_");
-		cell_types.insert("$_AND_");
-		cell_types.insert("$_OR_");
-		cell_types.insert("$_XOR_");
-		cell_types.insert("$_MUX_");
+		setup_type("$_INV_", { "\\A" }, { "\\Y" }, RTLIL::const_not);
+		setup_type("$_AND_", { "\\A", "\\B" }, { "\\Y" }, RTLIL::const_and, true);
+		setup_type("$_OR_", { "\\A", "\\B" }, { "\\Y" }, RTLIL::const_or, true);
+		setup_type("$_XOR_", { "\\A", "\\B" }, { "\\Y" }, RTLIL::const_xor, true);
+		setup_type("$_MUX_", { "\\A", "\\B", "\\S" }, { "\\Y" });
 	}
 
 	void setup_stdcells_mem()
 	{
-		cell_types.insert("$_SR_NN_");
-		cell_types.insert("$_SR_NP_");
-		cell_types.insert("$_SR_PN_");
-		cell_types.insert("$_SR_PP_");
-		cell_types.insert("$_DFF_N_");
-		cell_types.insert("$_DFF_P_");
-		cell_types.insert("$_DFF_NN0_");
-		cell_types.insert("$_DFF_NN1_");
-		cell_types.insert("$_DFF_NP0_");
-		cell_types.insert("$_DFF_NP1_");
-		cell_types.insert("$_DFF_PN0_");
-		cell_types.insert("$_DFF_PN1_");
-		cell_types.insert("$_DFF_PP0_");
-		cell_types.insert("$_DFF_PP1_");
-		cell_types.insert("$_DFFSR_NNN_");
-		cell_types.insert("$_DFFSR_NNP_");
-		cell_types.insert("$_DFFSR_NPN_");
-		cell_types.insert("$_DFFSR_NPP_");
-		cell_types.insert("$_DFFSR_PNN_");
-		cell_types.insert("$_DFFSR_PNP_");
-		cell_types.insert("$_DFFSR_PPN_");
-		cell_types.insert("$_DFFSR_PPP_");
-		cell_types.insert("$_DLATCH_N_");
-		cell_types.insert("$_DLATCH_P_");
-		cell_types.insert("$_DLATCHSR_NNN_");
-		cell_types.insert("$_DLATCHSR_NNP_");
-		cell_types.insert("$_DLATCHSR_NPN_");
-		cell_types.insert("$_DLATCHSR_NPP_");
-		cell_types.insert("$_DLATCHSR_PNN_");
-		cell_types.insert("$_DLATCHSR_PNP_");
-		cell_types.insert("$_DLATCHSR_PPN_");
-		cell_types.insert("$_DLATCHSR_PPP_");
+		std::vector<char> list_np = { 'N', 'P' }, list_01 = { '0', '1' };
+
+		for (auto c1 : list_np)
+		for (auto c2 : list_np)
+			setup_type(stringf("$_SR_%c%c_", c1, c2), { "\\S", "\\R" }, { "\\Q" });
+
+		for (auto c1 : list_np)
+			setup_type(stringf("$_DFF_%c_", c1), { "\\C", "\\D" }, { "\\Q" });
+
+		for (auto c1 : list_np)
+		for (auto c2 : list_np)
+		for (auto c3 : list_01)
+			setup_type(stringf("$_DFF_%c%c%c_", c1, c2, c3), { "\\C", "\\R", "\\D" }, { "\\Q" });
+
+		for (auto c1 : list_np)
+		for (auto c2 : list_np)
+		for (auto c3 : list_np)
+			setup_type(stringf("$_DFFSR_%c%c%c_", c1, c2, c3), { "\\C", "\\S", "\\R", "\\D" }, { "\\Q" });
+
+		for (auto c1 : list_np)
+			setup_type(stringf("$_DLATCH_%c_", c1), { "\\E", "\\D" }, { "\\Q" });
+
+		for (auto c1 : list_np)
+		for (auto c2 : list_np)
+		for (auto c3 : list_np)
+			setup_type(stringf("$_DLATCHSR_%c%c%c_", c1, c2, c3), { "\\E", "\\S", "\\R", "\\D" }, { "\\Q" });
 	}
 
 	void clear()
@@ -166,9 +191,20 @@ struct CellTypes
 		designs.clear();
 	}
 
-	bool cell_known(std::string type)
+	const RTLIL::Wire *design_port(const std::string &type, const std::string &port) const
+	{
+		for (auto design : designs)
+			if (design->modules.count(type) > 0) {
+				if (design->modules.at(type)->wires.count(port))
+					return design->modules.at(type)->wires.at(port);
+				return NULL;
+			}
+		return NULL;
+	}
+
+	bool cell_known(const std::string &type) const
 	{
-		if (cell_types.count(type) > 0)
+		if (cell_types.count(type) != 0)
 			return true;
 		for (auto design : designs)
 			if (design->modules.count(type) > 0)
@@ -176,45 +212,36 @@ struct CellTypes
 		return false;
 	}
 
-	bool cell_output(std::string type, std::string port)
+	bool cell_output(const std::string &type, const std::string &port) const
 	{
-		if (cell_types.count(type) == 0) {
-			for (auto design : designs)
-				if (design->modules.count(type) > 0) {
-					if (design->modules.at(type)->wires.count(port))
-						return design->modules.at(type)->wires.at(port)->port_output;
-					return false;
-				}
-			return false;
+		auto it = cell_types.find(type);
+		if (it == cell_types.end()) {
+			const RTLIL::Wire *wire = design_port(type, port);
+			return wire != NULL && wire->port_output;
 		}
-
-		if (port == "\\Y" || port == "\\Q" || port == "\\RD_DATA")
-			return true;
-		if (type == "$memrd" && port == "\\DATA")
-			return true;
-		if (type == "$fsm" && port == "\\CTRL_OUT")
-			return true;
-		if (type == "$lut" && port == "\\O")
-			return true;
-		return false;
+		return it->second.outputs.count(port) != 0;
 	}
 
-	bool cell_input(std::string type, std::string port)
+	bool cell_input(const std::string &type, const std::string &port) const
 	{
-		if (cell_types.count(type) == 0) {
-			for (auto design : designs)
-				if (design->modules.count(type) > 0) {
-					if (design->modules.at(type)->wires.count(port))
-						return design->modules.at(type)->wires.at(port)->port_input;
-					return false;
-				}
-			return false;
+		auto it = cell_types.find(type);
+		if (it == cell_types.end()) {
+			const RTLIL::Wire *wire = design_port(type, port);
+			return wire != NULL && wire->port_input;
 		}
+		return it->second.inputs.count(port) != 0;
+	}
 
-		if (cell_types.count(type) > 0)
-			return !cell_output(type, port);
+	bool cell_evaluable(const std::string &type) const
+	{
+		auto it = cell_types.find(type);
+		return it != cell_types.end() && it->second.eval_func != NULL;
+	}
 
-		return false;
+	bool cell_commutative(const std::string &type) const
+	{
+		auto it = cell_types.find(type);
+		return it != cell_types.end() && it->second.is_commutative;
 	}
 
 	static RTLIL::Const eval(std::string type, const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
@@ -230,53 +257,15 @@ struct CellTypes
 				signed1 = false, signed2 = false;
 		}
 
-#define HANDLE_CELL_TYPE(_t) if (type == "$" #_t) return const_ ## _t(arg1, arg2, signed1, signed2, result_len);
-		HANDLE_CELL_TYPE(not)
-		HANDLE_CELL_TYPE(and)
-		HANDLE_CELL_TYPE(or)
-		HANDLE_CELL_TYPE(xor)
-		HANDLE_CELL_TYPE(xnor)
-		HANDLE_CELL_TYPE(reduce_and)
-		HANDLE_CELL_TYPE(reduce_or)
-		HANDLE_CELL_TYPE(reduce_xor)
-		HANDLE_CELL_TYPE(reduce_xnor)
-		HANDLE_CELL_TYPE(reduce_bool)
-		HANDLE_CELL_TYPE(logic_not)
-		HANDLE_CELL_TYPE(logic_and)
-		HANDLE_CELL_TYPE(logic_or)
-		HANDLE_CELL_TYPE(shl)
-		HANDLE_CELL_TYPE(shr)
-		HANDLE_CELL_TYPE(sshl)
-		HANDLE_CELL_TYPE(sshr)
-		HANDLE_CELL_TYPE(lt)
-		HANDLE_CELL_TYPE(le)
-		HANDLE_CELL_TYPE(eq)
-		HANDLE_CELL_TYPE(ne)
-		HANDLE_CELL_TYPE(eqx)
-		HANDLE_CELL_TYPE(nex)
-		HANDLE_CELL_TYPE(ge)
-		HANDLE_CELL_TYPE(gt)
-		HANDLE_CELL_TYPE(add)
-		HANDLE_CELL_TYPE(sub)
-		HANDLE_CELL_TYPE(mul)
-		HANDLE_CELL_TYPE(div)
-		HANDLE_CELL_TYPE(mod)
-		HANDLE_CELL_TYPE(pow)
-		HANDLE_CELL_TYPE(pos)
-		HANDLE_CELL_TYPE(bu0)
-		HANDLE_CELL_TYPE(neg)
-#undef HANDLE_CELL_TYPE
-
-		if (type == "$_INV_")
-			return const_not(arg1, arg2, false, false, 1);
-		if (type == "$_AND_")
-			return const_and(arg1, arg2, false, false, 1);
-		if (type == "$_OR_")
-			return const_or(arg1, arg2, false, false, 1);
-		if (type == "$_XOR_")
-			return const_xor(arg1, arg2, false, false, 1);
-
-		log_abort();
+		static const CellTypes internal_types(NULL);
+		auto it = internal_types.cell_types.find(type);
+
+		if (it == internal_types.cell_types.end() || it->second.eval_func == NULL)
+			log_abort();
+
+		if (type.substr(0, 2) == "$_")
+			return it->second.eval_func(arg1, arg2, false, false, 1);
+		return it->second.eval_func(arg1, arg2, signed1, signed2, result_len);
 	}
 
 	static RTLIL::Const eval(RTLIL::Cell *cell, const RTLIL::Const &arg1, const RTLIL::Const &arg2)
@@ -28,11 +28,13 @@
 #include <stdarg.h>
 #include <vector>
 #include <list>
+#include <mutex>
 
 std::vector<FILE*> log_files;
 FILE *log_errfile = NULL;
 bool log_time = false;
 bool log_cmd_error_throw = false;
+thread_local bool log_error_throw = false;
 int log_verbose_level;
 
 std::vector<int> header_count;
@@ -41,6 +43,9 @@ std::list<std::string> string_buf;
 static struct timeval initial_tv = { 0, 0 };
 static bool next_print_log = false;
 
+// log messages may be created by worker threads (e.g. 'read_verilog -j')
+static std::recursive_mutex log_mutex;
+
 std::string stringf(const char *fmt, ...)
 {
 	std::string string;
@@ -62,6 +67,8 @@ std::string stringf(const char *fmt, ...)
 
 void logv(const char *format, va_list ap)
 {
+	std::lock_guard<std::recursive_mutex> lock(log_mutex);
+
 	if (log_time) {
 		while (format[0] == '\n' && format[1] != 0) {
 			format++;
@@ -115,6 +122,13 @@ void logv_header(const char *format, va_list ap)
 
 void logv_error(const char *format, va_list ap)
 {
+	if (log_error_throw) {
+		char *str = NULL;
+		std::string message = vasprintf(&str, format, ap) < 0 ? std::string(format) : std::string(str);
+		free(str);
+		throw message;
+	}
+
 	log("ERROR: ");
 	logv(format, ap);
 	if (log_errfile != NULL) {
@@ -153,7 +167,7 @@ void log_cmd_error(const char *format, ...)
 	va_list ap;
 	va_start(ap, format);
 
-	if (log_cmd_error_throw) {
+	if (log_cmd_error_throw && !log_error_throw) {
 		log("ERROR: ");
 		logv(format, ap);
 		log_flush();
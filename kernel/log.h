@@ -31,6 +31,11 @@ extern std::vector<FILE*> log_files;
 extern FILE *log_errfile;
 extern bool log_time;
 extern bool log_cmd_error_throw;
+
+// set by worker threads: log_error() and log_cmd_error() then throw the error
+// message as std::string instead of printing it and terminating the process,
+// so that the error can be reported by the main thread
+extern thread_local bool log_error_throw;
 extern int log_verbose_level;
 
 std::string stringf(const char *fmt, ...);
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <set>
 
 using namespace REGISTER_INTERN;
 #define MAX_REG_COUNT 1000
@@ -247,7 +248,8 @@ void Frontend::execute(std::vector<std::string> args, RTLIL::Design *design)
 		next_args.clear();
 		execute(f, std::string(), args, design);
 		args = next_args;
-		fclose(f);
+		if (f != NULL)
+			fclose(f);
 	} while (!args.empty());
 }
 
@@ -334,11 +336,20 @@ Backend::~Backend()
 {
 }
 
+// output files that are written through a 'gzip' process
+static std::set<FILE*> backend_gzip_pipes;
+
 void Backend::execute(std::vector<std::string> args, RTLIL::Design *design)
 {
 	FILE *f = NULL;
 	execute(f, std::string(), args, design);
-	if (f != stdout)
+	if (f == stdout)
+		return;
+	if (backend_gzip_pipes.count(f) > 0) {
+		backend_gzip_pipes.erase(f);
+		if (pclose(f) != 0)
+			log_error("Compressing output file with gzip failed.\n");
+	} else
 		fclose(f);
 }
 
@@ -362,9 +373,23 @@ void Backend::extra_args(FILE *&f, std::string &filename, std::vector<std::strin
 		}
 
 		filename = arg;
-		f = fopen(filename.c_str(), "w");
-		if (f == NULL)
-			log_cmd_error("Can't open output file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+		if (filename.size() > 3 && filename.substr(filename.size()-3) == ".gz") {
+			std::string quoted_filename = "'";
+			for (char ch : filename)
+				quoted_filename += ch == '\'' ? std::string("'\\''") : std::string(1, ch);
+			quoted_filename += "'";
+			f = popen(("gzip -c > " + quoted_filename).c_str(), "w");
+			if (f == NULL)
+				log_cmd_error("Can't run gzip for output file `%s': %s\n", filename.c_str(), strerror(errno));
+			backend_gzip_pipes.insert(f);
+		} else {
+			f = fopen(filename.c_str(), "w");
+			if (f == NULL)
+				log_cmd_error("Can't open output file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+		}
+
+		// netlists can be very large, use a bigger buffer than the default
+		setvbuf(f, NULL, _IOFBF, 1 << 20);
 	}
 
 	if (called_with_fp)
@@ -324,8 +324,15 @@ struct SatGen
 				std::vector<int> part_of_b(b.begin()+i*a.size(), b.begin()+(i+1)*a.size());
 				tmp = ez->vec_ite(s.at(i), part_of_b, tmp);
 			}
-			if (cell->type == "$safe_pmux")
-				tmp = ez->vec_ite(ez->onehot(s, true), tmp, a);
+			if (cell->type == "$safe_pmux") {
+				// ezSAT::onehot() uses auxiliary variables and can't be used as ite condition
+				int any_hot = ez->FALSE, many_hot = ez->FALSE;
+				for (size_t i = 0; i < s.size(); i++) {
+					many_hot = ez->OR(many_hot, ez->AND(any_hot, s.at(i)));
+					any_hot = ez->OR(any_hot, s.at(i));
+				}
+				tmp = ez->vec_ite(many_hot, a, tmp);
+			}
 			ez->assume(ez->vec_eq(tmp, yy));
 
 			if (model_undef)
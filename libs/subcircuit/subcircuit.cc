@@ -21,6 +21,10 @@
 #include "subcircuit.h"
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <iterator>
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -291,6 +295,10 @@ class SubCircuit::SolverWorker
 		Graph graph;
 		adjMatrix_t adjMatrix;
 		std::vector<bool> usedNodes;
+
+		// candidate index, built once in addGraph()
+		std::map<std::string, std::vector<int>> nodesByTypeId;
+		std::vector<std::map<std::string, int>> neighbourTypes;
 	};
 
 	static void printAdjMatrix(const adjMatrix_t &matrix)
@@ -655,6 +663,9 @@ class SubCircuit::SolverWorker
 		std::vector<DiEdge> edgeTypes;
 		std::map<std::pair<int, int>, bool> compareCache;
 
+		// worker threads of a parallel solve use their own private compare cache
+		static thread_local std::map<std::pair<int, int>, bool> *threadCompareCache;
+
 		void add(const Graph &graph, adjMatrix_t &adjMatrix, const std::string &graphId, Solver *userSolver)
 		{
 			std::map<std::pair<int, int>, DiEdge> edges;
@@ -681,10 +692,12 @@ class SubCircuit::SolverWorker
 		bool compare(int needleEdge, int haystackEdge, const std::map<std::string, std::set<std::set<std::string>>> &swapPorts,
 				const std::map<std::string, std::set<std::map<std::string, std::string>>> &swapPermutations)
 		{
+			std::map<std::pair<int, int>, bool> &cache = threadCompareCache ? *threadCompareCache : compareCache;
 			std::pair<int, int> key(needleEdge, haystackEdge);
-			if (!compareCache.count(key))
-				compareCache[key] = edgeTypes.at(needleEdge).compare(edgeTypes.at(haystackEdge), swapPorts, swapPermutations);
-			return compareCache[key];
+			auto it = cache.find(key);
+			if (it == cache.end())
+				it = cache.insert(std::make_pair(key, edgeTypes.at(needleEdge).compare(edgeTypes.at(haystackEdge), swapPorts, swapPermutations))).first;
+			return it->second;
 		}
 
 		bool compare(int needleEdge, int haystackEdge, const std::map<std::string, std::string> &mapFromPorts, const std::map<std::string, std::set<std::set<std::string>>> &swapPorts,
@@ -844,37 +857,86 @@ class SubCircuit::SolverWorker
 		return false;
 	}
 
-	void generateEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, const std::map<std::string, std::set<std::string>> &initialMappings) const
+	static void buildCandidateIndex(GraphData &gd)
+	{
+		gd.nodesByTypeId.clear();
+		gd.neighbourTypes.clear();
+		gd.neighbourTypes.resize(gd.graph.nodes.size());
+
+		for (int i = 0; i < int(gd.graph.nodes.size()); i++) {
+			gd.nodesByTypeId[gd.graph.nodes[i].typeId].push_back(i);
+			for (const auto &it : gd.adjMatrix[i])
+				gd.neighbourTypes[i][gd.graph.nodes[it.first].typeId]++;
+		}
+	}
+
+	bool matchNeighbourhood(const GraphData &needle, int needleNodeIdx, const GraphData &haystack, int haystackNodeIdx) const
+	{
+		// every needle neighbour must be mapped to a different haystack neighbour
+		// of the same or a compatible type, so the haystack node needs at least as
+		// many neighbours of each kind as the needle node
+
+		if (needle.adjMatrix[needleNodeIdx].size() > haystack.adjMatrix[haystackNodeIdx].size())
+			return false;
+
+		const std::map<std::string, int> &haystackTypes = haystack.neighbourTypes[haystackNodeIdx];
+
+		for (const auto &it : needle.neighbourTypes[needleNodeIdx])
+		{
+			int count = 0;
+			auto hit = haystackTypes.find(it.first);
+			if (hit != haystackTypes.end())
+				count += hit->second;
+
+			auto cit = compatibleTypes.find(it.first);
+			if (cit != compatibleTypes.end())
+				for (const std::string &compatibleTypeId : cit->second) {
+					hit = haystackTypes.find(compatibleTypeId);
+					if (hit != haystackTypes.end())
+						count += hit->second;
+				}
+
+			if (count < it.second)
+				return false;
+		}
+
+		return true;
+	}
+
+	void generateEnumerationMatrixRow(std::set<int> &row, const GraphData &needle, int needleNodeIdx, const GraphData &haystack,
+			const std::string &haystackTypeId, const std::map<std::string, std::set<std::string>> &initialMappings) const
 	{
-		std::map<std::string, std::set<int>> haystackNodesByTypeId;
-		for (int i = 0; i < int(haystack.graph.nodes.size()); i++)
-			haystackNodesByTypeId[haystack.graph.nodes[i].typeId].insert(i);
+		auto it = haystack.nodesByTypeId.find(haystackTypeId);
+		if (it == haystack.nodesByTypeId.end())
+			return;
 
+		const Graph::Node &nn = needle.graph.nodes[needleNodeIdx];
+		const std::set<std::string> *initialMapping = initialMappings.count(nn.nodeId) > 0 ? &initialMappings.at(nn.nodeId) : NULL;
+
+		for (int j : it->second) {
+			if (initialMapping != NULL && initialMapping->count(haystack.graph.nodes[j].nodeId) == 0)
+				continue;
+			if (!matchNeighbourhood(needle, needleNodeIdx, haystack, j))
+				continue;
+			if (!matchNodes(needle, needleNodeIdx, haystack, j))
+				continue;
+			row.insert(j);
+		}
+	}
+
+	void generateEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, const std::map<std::string, std::set<std::string>> &initialMappings) const
+	{
 		enumerationMatrix.clear();
 		enumerationMatrix.resize(needle.graph.nodes.size());
 		for (int i = 0; i < int(needle.graph.nodes.size()); i++)
 		{
 			const Graph::Node &nn = needle.graph.nodes[i];
 
-			for (int j : haystackNodesByTypeId[nn.typeId]) {
-				const Graph::Node &hn = haystack.graph.nodes[j];
-				if (initialMappings.count(nn.nodeId) > 0 && initialMappings.at(nn.nodeId).count(hn.nodeId) == 0)
-					continue;
-				if (!matchNodes(needle, i, haystack, j))
-					continue;
-				enumerationMatrix[i].insert(j);
-			}
+			generateEnumerationMatrixRow(enumerationMatrix[i], needle, i, haystack, nn.typeId, initialMappings);
 
 			if (compatibleTypes.count(nn.typeId) > 0)
 				for (const std::string &compatibleTypeId : compatibleTypes.at(nn.typeId))
-					for (int j : haystackNodesByTypeId[compatibleTypeId]) {
-						const Graph::Node &hn = haystack.graph.nodes[j];
-						if (initialMappings.count(nn.nodeId) > 0 && initialMappings.at(nn.nodeId).count(hn.nodeId) == 0)
-							continue;
-						if (!matchNodes(needle, i, haystack, j))
-							continue;
-						enumerationMatrix[i].insert(j);
-					}
+					generateEnumerationMatrixRow(enumerationMatrix[i], needle, i, haystack, compatibleTypeId, initialMappings);
 		}
 	}
 
@@ -1100,7 +1162,8 @@ class SubCircuit::SolverWorker
 		return false;
 	}
 
-	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<std::set<int>> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack, bool allowOverlap, int limitResults)
+	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<std::set<int>> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack,
+			bool allowOverlap, int limitResults, bool recordUsedNodes = true)
 	{
 		int i = -1;
 		if (!pruneEnumerationMatrix(enumerationMatrix, needle, haystack, i, allowOverlap))
@@ -1108,6 +1171,13 @@ class SubCircuit::SolverWorker
 
 		if (i < 0)
 		{
+			// rows that never were branched on are not mutually exclusive, so make
+			// sure that no two needle nodes are mapped to the same haystack node
+			std::set<int> haystackNodes;
+			for (const auto &row : enumerationMatrix)
+				if (!haystackNodes.insert(*row.begin()).second)
+					return;
+
 			Solver::Result result;
 			result.needleGraphId = needle.graphId;
 			result.haystackGraphId = haystack.graphId;
@@ -1161,7 +1231,7 @@ class SubCircuit::SolverWorker
 				return;
 			}
 
-			for (int j = 0; j < int(enumerationMatrix.size()); j++)
+			for (int j = 0; recordUsedNodes && j < int(enumerationMatrix.size()); j++)
 				if (!haystack.graph.nodes[*enumerationMatrix[j].begin()].shared)
 					haystack.usedNodes[*enumerationMatrix[j].begin()] = true;
 
@@ -1200,7 +1270,7 @@ class SubCircuit::SolverWorker
 			nextEnumerationMatrix[i].insert(j);
 
 			// recursion
-			ullmannRecursion(results, nextEnumerationMatrix, iter+1, needle, haystack, allowOverlap, limitResults);
+			ullmannRecursion(results, nextEnumerationMatrix, iter+1, needle, haystack, allowOverlap, limitResults, recordUsedNodes);
 
 			// we just have found something -> unroll to top recursion level
 			if (!allowOverlap && haystack.usedNodes[j] && iter > 0)
@@ -1256,51 +1326,131 @@ class SubCircuit::SolverWorker
 		}
 	};
 
-	void solveForMining(std::vector<Solver::Result> &results, const GraphData &needle)
+	// The haystack nodes that matched each needle node of a tested node set:
+	// needle node id -> haystack graph id -> haystack node indices. A match of a
+	// larger node set restricted to the nodes of a smaller set is a match of the
+	// smaller set, so this limits the candidates when testing merged sets.
+	typedef std::map<std::string, std::map<std::string, std::set<int>>> mineCandidates_t;
+
+	struct MinePoolEntry {
+		std::shared_ptr<const mineCandidates_t> candidates;
+		std::map<int, std::string> needleNodeIds;
+	};
+
+	typedef std::map<NodeSet, MinePoolEntry> minePool_t;
+
+	struct MineTest {
+		NodeSet testSet;
+		bool restricted;
+		mineCandidates_t restriction;
+		GraphData needle;
+		std::vector<Solver::Result> ullmannResults;
+		MineTest(const NodeSet &testSet) : testSet(testSet), restricted(false) { }
+	};
+
+	bool compatibleTypeIds(const std::string &needleTypeId, const std::string &haystackTypeId) const
 	{
-		bool backupVerbose = verbose;
-		verbose = false;
+		if (needleTypeId == haystackTypeId)
+			return true;
+		auto it = compatibleTypes.find(needleTypeId);
+		return it != compatibleTypes.end() && it->second.count(haystackTypeId) > 0;
+	}
 
+	void solveForMining(std::vector<Solver::Result> &results, const GraphData &needle, const mineCandidates_t *restriction)
+	{
 		for (auto &it : graphData)
 		{
 			GraphData &haystack = it.second;
-
 			std::vector<std::set<int>> enumerationMatrix;
-			std::map<std::string, std::set<std::string>> initialMappings;
-			generateEnumerationMatrix(enumerationMatrix, needle, haystack, initialMappings);
 
-			haystack.usedNodes.resize(haystack.graph.nodes.size());
-			ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, true, -1);
+			if (restriction == NULL) {
+				std::map<std::string, std::set<std::string>> initialMappings;
+				generateEnumerationMatrix(enumerationMatrix, needle, haystack, initialMappings);
+			} else {
+				enumerationMatrix.resize(needle.graph.nodes.size());
+				for (int i = 0; i < int(needle.graph.nodes.size()); i++) {
+					const Graph::Node &nn = needle.graph.nodes[i];
+					const auto &images = restriction->at(nn.nodeId);
+					auto images_it = images.find(it.first);
+					if (images_it == images.end())
+						goto next_haystack;
+					for (int j : images_it->second)
+						if (compatibleTypeIds(nn.typeId, haystack.graph.nodes[j].typeId) &&
+								matchNeighbourhood(needle, i, haystack, j) && matchNodes(needle, i, haystack, j))
+							enumerationMatrix[i].insert(j);
+					if (enumerationMatrix[i].empty())
+						goto next_haystack;
+				}
+			}
+
+			ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, true, -1, false);
+		next_haystack:;
+		}
+	}
+
+	void runMineTests(std::vector<MineTest> &tests, std::vector<std::map<std::pair<int, int>, bool>> &threadCompareCaches)
+	{
+		// building the needle graphs registers new edge types with diCache,
+		// so this part runs serially before the solver threads are started
+
+		for (auto &test : tests) {
+			const Graph &graph = graphData.at(test.testSet.graphId).graph;
+			std::vector<std::string> needle_nodes;
+			for (int nodeIdx : test.testSet.nodes)
+				needle_nodes.push_back(graph.nodes[nodeIdx].nodeId);
+			test.needle.graph = Graph(graph, needle_nodes);
+			test.needle.graph.markAllExtern();
+			diCache.add(test.needle.graph, test.needle.adjMatrix, test.testSet.graphId, userSolver);
+			buildCandidateIndex(test.needle);
+		}
+
+		bool backupVerbose = verbose;
+		verbose = false;
+
+		if (threadCompareCaches.size() <= 1 || tests.size() <= 1)
+		{
+			for (auto &test : tests)
+				solveForMining(test.ullmannResults, test.needle, test.restricted ? &test.restriction : NULL);
+		}
+		else
+		{
+			std::atomic<size_t> nextTest(0);
+			std::vector<std::thread> workers;
+			for (int i = 0; i < int(threadCompareCaches.size()) && i < int(tests.size()); i++)
+				workers.push_back(std::thread([&](int threadIdx) {
+					DiCache::threadCompareCache = &threadCompareCaches[threadIdx];
+					for (size_t idx = nextTest++; idx < tests.size(); idx = nextTest++)
+						solveForMining(tests[idx].ullmannResults, tests[idx].needle, tests[idx].restricted ? &tests[idx].restriction : NULL);
+					DiCache::threadCompareCache = NULL;
+				}, i));
+			for (auto &worker : workers)
+				worker.join();
 		}
 
 		verbose = backupVerbose;
 	}
 
-	int testForMining(std::vector<Solver::MineResult> &results, std::set<NodeSet> &usedSets, std::set<NodeSet> &nextPool, NodeSet &testSet,
+	int testForMining(std::vector<Solver::MineResult> &results, std::set<NodeSet> &usedSets, minePool_t &nextPool, const MineTest &test,
 			const std::string &graphId, const Graph &graph, int minNodes, int minMatches, int limitMatchesPerGraph)
 	{
-		// my_printf("test: %s\n", testSet.to_string().c_str());
-
-		GraphData needle;
-		std::vector<std::string> needle_nodes;
-		for (int nodeIdx : testSet.nodes)
-			needle_nodes.push_back(graph.nodes[nodeIdx].nodeId);
-		needle.graph = Graph(graph, needle_nodes);
-		needle.graph.markAllExtern();
-		diCache.add(needle.graph, needle.adjMatrix, graphId, userSolver);
-
-		std::vector<Solver::Result> ullmannResults;
-		solveForMining(ullmannResults, needle);
+		// my_printf("test: %s\n", test.testSet.to_string().c_str());
 
 		int matches = 0;
 		std::map<std::string, int> matchesPerGraph;
-		std::set<NodeSet> thisNodeSetSet;
+		std::map<NodeSet, std::map<int, std::string>> thisNodeSetSet;
+		std::shared_ptr<mineCandidates_t> candidates(new mineCandidates_t);
 
-		for (auto &it : ullmannResults)
+		for (auto &it : test.ullmannResults)
 		{
+			const GraphData &haystack = graphData.at(it.haystackGraphId);
 			std::vector<int> resultNodes;
-			for (auto &i2 : it.mappings)
-				resultNodes.push_back(graphData[it.haystackGraphId].graph.nodeMap[i2.second.haystackNodeId]);
+			std::map<int, std::string> needleNodeIds;
+			for (auto &i2 : it.mappings) {
+				int nodeIdx = haystack.graph.nodeMap.at(i2.second.haystackNodeId);
+				resultNodes.push_back(nodeIdx);
+				needleNodeIds[nodeIdx] = i2.first;
+				(*candidates)[i2.first][it.haystackGraphId].insert(nodeIdx);
+			}
 			NodeSet resultSet(it.haystackGraphId, resultNodes);
 
 			// my_printf("match: %s%s\n", resultSet.to_string().c_str(), usedSets.count(resultSet) > 0 ? " (dup)" : "");
@@ -1322,7 +1472,7 @@ class SubCircuit::SolverWorker
 #endif
 
 			usedSets.insert(resultSet);
-			thisNodeSetSet.insert(resultSet);
+			thisNodeSetSet[resultSet].swap(needleNodeIds);
 
 			matchesPerGraph[it.haystackGraphId]++;
 			if (limitMatchesPerGraph < 0 || matchesPerGraph[it.haystackGraphId] < limitMatchesPerGraph)
@@ -1332,13 +1482,13 @@ class SubCircuit::SolverWorker
 		if (matches < minMatches)
 			return matches;
 
-		if (minNodes <= int(testSet.nodes.size()))
+		if (minNodes <= int(test.testSet.nodes.size()))
 		{
 			Solver::MineResult result;
 			result.graphId = graphId;
 			result.totalMatchesAfterLimits = matches;
 			result.matchesPerGraph = matchesPerGraph;
-			for (int nodeIdx : testSet.nodes) {
+			for (int nodeIdx : test.testSet.nodes) {
 				Solver::MineResultNode resultNode;
 				resultNode.nodeId = graph.nodes[nodeIdx].nodeId;
 				resultNode.userData = graph.nodes[nodeIdx].userData;
@@ -1347,14 +1497,52 @@ class SubCircuit::SolverWorker
 			results.push_back(result);
 		}
 
-		nextPool.insert(thisNodeSetSet.begin(), thisNodeSetSet.end());
+		for (auto &it : thisNodeSetSet)
+			if (nextPool.count(it.first) == 0) {
+				MinePoolEntry &entry = nextPool[it.first];
+				entry.candidates = candidates;
+				entry.needleNodeIds.swap(it.second);
+			}
+
 		return matches;
 	}
 
-	void findNodePairs(std::vector<Solver::MineResult> &results, std::set<NodeSet> &nodePairs, int minNodes, int minMatches, int limitMatchesPerGraph)
+	void addMineRestriction(mineCandidates_t &restriction, const NodeSet &nodeSet, const MinePoolEntry &entry, const Graph &graph)
+	{
+		for (int node : nodeSet.nodes)
+		{
+			const std::string &nodeId = graph.nodes[node].nodeId;
+			const auto &images = entry.candidates->at(entry.needleNodeIds.at(node));
+
+			auto it = restriction.find(nodeId);
+			if (it == restriction.end()) {
+				restriction[nodeId] = images;
+				continue;
+			}
+
+			// node is part of both merged sets: use the intersection
+			for (auto graph_it = it->second.begin(); graph_it != it->second.end();) {
+				auto other_it = images.find(graph_it->first);
+				if (other_it == images.end()) {
+					it->second.erase(graph_it++);
+					continue;
+				}
+				std::set<int> intersection;
+				std::set_intersection(graph_it->second.begin(), graph_it->second.end(), other_it->second.begin(), other_it->second.end(),
+						std::inserter(intersection, intersection.begin()));
+				graph_it->second.swap(intersection);
+				++graph_it;
+			}
+		}
+	}
+
+	void findNodePairs(std::vector<Solver::MineResult> &results, minePool_t &nodePairs, int minNodes, int minMatches, int limitMatchesPerGraph,
+			std::vector<std::map<std::pair<int, int>, bool>> &threadCompareCaches)
 	{
 		int groupCounter = 0;
 		std::set<NodeSet> usedPairs;
+		std::vector<NodeSet> pairs;
+		std::vector<std::pair<int, int>> pairNodes;
 		nodePairs.clear();
 
 		if (verbose)
@@ -1363,42 +1551,65 @@ class SubCircuit::SolverWorker
 		for (auto &graph_it : graphData)
 		for (int node1 = 0; node1 < int(graph_it.second.graph.nodes.size()); node1++)
 		for (auto &adj_it : graph_it.second.adjMatrix.at(node1))
+			if (node1 != adj_it.first) {
+				pairs.push_back(NodeSet(graph_it.first, node1, adj_it.first));
+				pairNodes.push_back(std::pair<int, int>(node1, adj_it.first));
+			}
+
+		// The pairs are tested in waves of one pair per thread. The results are
+		// processed in order, so a pair that is matched by an earlier pair of
+		// the same wave is skipped just like in a serial run.
+
+		for (size_t pos = 0; pos < pairs.size();)
 		{
-			const std::string &graphId = graph_it.first;
-			const auto &graph = graph_it.second.graph;
-			int node2 = adj_it.first;
+			std::vector<MineTest> wave;
+			std::map<NodeSet, int> waveIndex;
+			std::vector<std::pair<int, size_t>> waveOrder;
 
-			if (node1 == node2)
-				continue;
+			for (; pos < pairs.size() && wave.size() < threadCompareCaches.size(); pos++) {
+				if (usedPairs.count(pairs[pos]) > 0)
+					continue;
+				if (waveIndex.count(pairs[pos]) == 0) {
+					waveIndex[pairs[pos]] = wave.size();
+					wave.push_back(MineTest(pairs[pos]));
+				}
+				waveOrder.push_back(std::pair<int, size_t>(waveIndex.at(pairs[pos]), pos));
+			}
 
-			NodeSet pair(graphId, node1, node2);
+			runMineTests(wave, threadCompareCaches);
 
-			if (usedPairs.count(pair) > 0)
-				continue;
+			for (auto &order_it : waveOrder)
+			{
+				const MineTest &test = wave[order_it.first];
+				if (usedPairs.count(test.testSet) > 0)
+					continue;
 
-			int matches = testForMining(results, usedPairs, nodePairs, pair, graphId, graph, minNodes, minMatches, limitMatchesPerGraph);
+				const std::string &graphId = test.testSet.graphId;
+				const auto &graph = graphData.at(graphId).graph;
+				int matches = testForMining(results, usedPairs, nodePairs, test, graphId, graph, minNodes, minMatches, limitMatchesPerGraph);
 
-			if (verbose)
-				my_printf("Pair %s[%s,%s] -> %d%s\n", graphId.c_str(), graph.nodes[node1].nodeId.c_str(),
-						graph.nodes[node2].nodeId.c_str(), matches, matches < minMatches ? "  *purge*" : "");
+				if (verbose)
+					my_printf("Pair %s[%s,%s] -> %d%s\n", graphId.c_str(), graph.nodes[pairNodes[order_it.second].first].nodeId.c_str(),
+							graph.nodes[pairNodes[order_it.second].second].nodeId.c_str(), matches, matches < minMatches ? "  *purge*" : "");
 
-			if (minMatches <= matches)
-				groupCounter++;
+				if (minMatches <= matches)
+					groupCounter++;
+			}
 		}
 
 		if (verbose)
 			my_printf("Found a total of %d subgraphs in %d groups.\n", int(nodePairs.size()), groupCounter);
 	}
 
-	void findNextPool(std::vector<Solver::MineResult> &results, std::set<NodeSet> &pool,
-			int oldSetSize, int increment, int minNodes, int minMatches, int limitMatchesPerGraph)
+	void findNextPool(std::vector<Solver::MineResult> &results, minePool_t &pool, int oldSetSize, int increment, int minNodes, int minMatches, int limitMatchesPerGraph,
+			std::vector<std::map<std::pair<int, int>, bool>> &threadCompareCaches)
 	{
 		int groupCounter = 0;
-		std::map<std::string, std::vector<const NodeSet*>> poolPerGraph;
-		std::set<NodeSet> nextPool;
+		std::map<std::string, std::vector<minePool_t::const_iterator>> poolPerGraph;
+		minePool_t nextPool;
 
-		for (auto &it : pool)
-			poolPerGraph[it.graphId].push_back(&it);
+		for (auto it = pool.begin(); it != pool.end(); it++)
+			poolPerGraph[it->first.graphId].push_back(it);
 
 		if (verbose)
 			my_printf("\nMining for frequent subcircuits of size %d using increment %d:\n", oldSetSize+increment, increment);
@@ -1406,48 +1617,88 @@ class SubCircuit::SolverWorker
 		int count = 0;
 		for (auto &it : poolPerGraph)
 		{
+			const std::string &graphId = it.first;
+			const auto &graph = graphData.at(it.first).graph;
 			std::map<int, std::set<int>> node2sets;
 			std::set<NodeSet> usedSets;
 
 			for (int idx = 0; idx < int(it.second.size()); idx++) {
-				for (int node : it.second[idx]->nodes)
+				for (int node : it.second[idx]->first.nodes)
 					node2sets[node].insert(idx);
 			}
 
+			// list all merge candidates with the progress counter for the verbose output
+			std::vector<std::pair<int, int>> merges;
+			std::vector<int> mergesCount;
+
 			for (int idx1 = 0; idx1 < int(it.second.size()); idx1++, count++)
 			{
 				std::set<int> idx2set;
 
-				for (int node : it.second[idx1]->nodes)
+				for (int node : it.second[idx1]->first.nodes)
 					for (int idx2 : node2sets[node])
 						if (idx2 > idx1)
 							idx2set.insert(idx2);
 
 				for (int idx2 : idx2set)
+					if (it.second[idx1]->first.extendCandidate(it.second[idx2]->first) == increment) {
+						merges.push_back(std::pair<int, int>(idx1, idx2));
+						mergesCount.push_back(count);
+					}
+			}
+
+			// test the merged sets in waves (see findNodePairs())
+			for (size_t pos = 0; pos < merges.size();)
+			{
+				std::vector<MineTest> wave;
+				std::map<NodeSet, int> waveIndex;
+				std::vector<std::pair<int, int>> waveOrder;
+
+				for (; pos < merges.size() && wave.size() < threadCompareCaches.size(); pos++)
 				{
-					if (it.second[idx1]->extendCandidate(*it.second[idx2]) != increment)
-						continue;
+					const auto &entry1 = *it.second[merges[pos].first];
+					const auto &entry2 = *it.second[merges[pos].second];
 
-					NodeSet mergedSet = *it.second[idx1];
-					mergedSet.extend(*it.second[idx2]);
+					NodeSet mergedSet = entry1.first;
+					mergedSet.extend(entry2.first);
 
 					if (usedSets.count(mergedSet) > 0)
 						continue;
 
-					const std::string &graphId = it.first;
-					const auto &graph = graphData[it.first].graph;
+					// the restriction relies on the matches of the parts being complete,
+					// which is not the case when compatibleTypes is not transitive, so
+					// the unrestricted search is used when there are compatible types
+					if (waveIndex.count(mergedSet) == 0) {
+						waveIndex[mergedSet] = wave.size();
+						wave.push_back(MineTest(mergedSet));
+						if (compatibleTypes.empty()) {
+							wave.back().restricted = true;
+							addMineRestriction(wave.back().restriction, entry1.first, entry1.second, graph);
+							addMineRestriction(wave.back().restriction, entry2.first, entry2.second, graph);
+						}
+					}
+					waveOrder.push_back(std::pair<int, int>(waveIndex.at(mergedSet), mergesCount[pos]));
+				}
+
+				runMineTests(wave, threadCompareCaches);
+
+				for (auto &order_it : waveOrder)
+				{
+					const MineTest &test = wave[order_it.first];
+					if (usedSets.count(test.testSet) > 0)
+						continue;
 
 					if (verbose) {
-						my_printf("<%d%%/%d> Found %s[", int(100*count/pool.size()), oldSetSize+increment, graphId.c_str());
+						my_printf("<%d%%/%d> Found %s[", int(100*order_it.second/pool.size()), oldSetSize+increment, graphId.c_str());
 						bool first = true;
-						for (int nodeIdx : mergedSet.nodes) {
+						for (int nodeIdx : test.testSet.nodes) {
 							my_printf("%s%s", first ? "" : ",", graph.nodes[nodeIdx].nodeId.c_str());
 							first = false;
 						}
 						my_printf("] ->");
 					}
 
-					int matches = testForMining(results, usedSets, nextPool, mergedSet, graphId, graph, minNodes, minMatches, limitMatchesPerGraph);
+					int matches = testForMining(results, usedSets, nextPool, test, graphId, graph, minNodes, minMatches, limitMatchesPerGraph);
 
 					if (verbose)
 						my_printf(" %d%s\n", matches, matches < minMatches ? "  *purge*" : "");
@@ -1484,6 +1735,7 @@ protected:
 		gd.graphId = graphId;
 		gd.graph = graph;
 		diCache.add(gd.graph, gd.adjMatrix, graphId, userSolver);
+		buildCandidateIndex(gd);
 	}
 
 	void addCompatibleTypes(std::string needleTypeId, std::string haystackTypeId)
@@ -1514,9 +1766,63 @@ protected:
 		assert(graphData.count(needleGraphId) > 0);
 		assert(graphData.count(haystackGraphId) > 0);
 
-		const GraphData &needle = graphData[needleGraphId];
-		GraphData &haystack = graphData[haystackGraphId];
+		solveJob(results, graphData.at(needleGraphId), graphData.at(haystackGraphId), initialMappings, allowOverlap, maxSolutions);
+	}
+
+	void solve(std::vector<Solver::Result> &results, const std::vector<Solver::SolveJob> &jobs, int numThreads, bool allowOverlap, int maxSolutions)
+	{
+		// jobs on the same haystack depend on each other through the overlap history,
+		// so all jobs for one haystack are run in order by the same thread
+
+		std::map<std::string, int> haystackGroupIdx;
+		std::vector<std::vector<int>> haystackGroups;
+
+		for (int i = 0; i < int(jobs.size()); i++) {
+			assert(graphData.count(jobs[i].needleGraphId) > 0);
+			assert(graphData.count(jobs[i].haystackGraphId) > 0);
+			if (haystackGroupIdx.count(jobs[i].haystackGraphId) == 0) {
+				haystackGroupIdx[jobs[i].haystackGraphId] = haystackGroups.size();
+				haystackGroups.push_back(std::vector<int>());
+			}
+			haystackGroups[haystackGroupIdx.at(jobs[i].haystackGraphId)].push_back(i);
+		}
+
+		std::vector<std::vector<Solver::Result>> jobResults(jobs.size());
 
+		auto runGroup = [&](int groupIdx) {
+			for (int i : haystackGroups[groupIdx])
+				solveJob(jobResults[i], graphData.at(jobs[i].needleGraphId), graphData.at(jobs[i].haystackGraphId),
+						jobs[i].initialMappings, allowOverlap, maxSolutions);
+		};
+
+		if (numThreads <= 1 || verbose || haystackGroups.size() <= 1)
+		{
+			for (int i = 0; i < int(haystackGroups.size()); i++)
+				runGroup(i);
+		}
+		else
+		{
+			std::atomic<size_t> nextGroup(0);
+			std::vector<std::thread> workers;
+			for (int i = 0; i < numThreads && i < int(haystackGroups.size()); i++)
+				workers.push_back(std::thread([&]() {
+					std::map<std::pair<int, int>, bool> localCompareCache = diCache.compareCache;
+					DiCache::threadCompareCache = &localCompareCache;
+					for (size_t idx = nextGroup++; idx < haystackGroups.size(); idx = nextGroup++)
+						runGroup(idx);
+					DiCache::threadCompareCache = NULL;
+				}));
+			for (auto &worker : workers)
+				worker.join();
+		}
+
+		for (auto &it : jobResults)
+			results.insert(results.end(), it.begin(), it.end());
+	}
+
+	void solveJob(std::vector<Solver::Result> &results, const GraphData &needle, GraphData &haystack,
+			const std::map<std::string, std::set<std::string>> &initialMappings, bool allowOverlap, int maxSolutions)
+	{
 		std::vector<std::set<int>> enumerationMatrix;
 		generateEnumerationMatrix(enumerationMatrix, needle, haystack, initialMappings);
 
@@ -1553,11 +1859,14 @@ protected:
 		ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, allowOverlap, maxSolutions > 0 ? results.size() + maxSolutions : -1);
 	}
 
-	void mine(std::vector<Solver::MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph)
+	void mine(std::vector<Solver::MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph, int numThreads)
 	{
+		// one compare cache per solver thread, kept for the whole mining run
+		std::vector<std::map<std::pair<int, int>, bool>> threadCompareCaches(std::max(numThreads, 1));
+
 		int nodeSetSize = 2;
-		std::set<NodeSet> pool;
-		findNodePairs(results, pool, minNodes, minMatches, limitMatchesPerGraph);
+		minePool_t pool;
+		findNodePairs(results, pool, minNodes, minMatches, limitMatchesPerGraph, threadCompareCaches);
 
 		while ((maxNodes < 0 || nodeSetSize < maxNodes) && pool.size() > 0)
 		{
@@ -1567,7 +1876,7 @@ protected:
 			if (nodeSetSize >= minNodes)
 				increment = 1;
 
-			findNextPool(results, pool, nodeSetSize, increment, minNodes, minMatches, limitMatchesPerGraph);
+			findNextPool(results, pool, nodeSetSize, increment, minNodes, minMatches, limitMatchesPerGraph, threadCompareCaches);
 			nodeSetSize += increment;
 		}
 	}
@@ -1590,6 +1899,8 @@ protected:
 	friend class Solver;
 };
 
+thread_local std::map<std::pair<int, int>, bool> *SubCircuit::SolverWorker::DiCache::threadCompareCache = NULL;
+
 bool Solver::userCompareNodes(const std::string&, const std::string&, void*, const std::string&, const std::string&, void*, const std::map<std::string, std::string>&)
 {
 	return true;
@@ -1673,9 +1984,14 @@ void SubCircuit::Solver::solve(std::vector<Result> &results, std::string needleG
 	worker->solve(results, needleGraphId, haystackGraphId, initialMappings, allowOverlap, maxSolutions);
 }
 
-void SubCircuit::Solver::mine(std::vector<MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph)
+void SubCircuit::Solver::solve(std::vector<Result> &results, const std::vector<SolveJob> &jobs, int numThreads, bool allowOverlap, int maxSolutions)
+{
+	worker->solve(results, jobs, numThreads, allowOverlap, maxSolutions);
+}
+
+void SubCircuit::Solver::mine(std::vector<MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph, int numThreads)
 {
-	worker->mine(results, minNodes, maxNodes, minMatches, limitMatchesPerGraph);
+	worker->mine(results, minNodes, maxNodes, minMatches, limitMatchesPerGraph, numThreads);
 }
 
 void SubCircuit::Solver::clearOverlapHistory()
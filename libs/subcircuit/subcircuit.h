@@ -102,6 +102,13 @@ namespace SubCircuit
 			std::map<std::string, ResultNodeMapping> mappings;
 		};
 
+		struct SolveJob {
+			std::string needleGraphId, haystackGraphId;
+			std::map<std::string, std::set<std::string>> initialMappings;
+			SolveJob(std::string needleGraphId = std::string(), std::string haystackGraphId = std::string()) :
+					needleGraphId(needleGraphId), haystackGraphId(haystackGraphId) { };
+		};
+
 		struct MineResultNode {
 			std::string nodeId;
 			void *userData;
@@ -145,7 +152,14 @@ namespace SubCircuit
 		void solve(std::vector<Result> &results, std::string needleGraphId, std::string haystackGraphId,
 				const std::map<std::string, std::set<std::string>> &initialMapping, bool allowOverlap = true, int maxSolutions = -1);
 
-		void mine(std::vector<MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph = -1);
+		// Solve a list of jobs using numThreads threads. Jobs on different haystack graphs
+		// run in parallel and the user callbacks must be thread-safe. The results are the
+		// same, and in the same order, as when calling solve() for each job in turn.
+		void solve(std::vector<Result> &results, const std::vector<SolveJob> &jobs, int numThreads, bool allowOverlap = true, int maxSolutions = -1);
+
+		// Merged candidate sets are only searched for where their parts have matched,
+		// unless compatible types have been added (see addCompatibleTypes()).
+		void mine(std::vector<MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph = -1, int numThreads = 1);
 
 		void clearOverlapHistory();
 		void clearConfig();
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <set>
+#include <algorithm>
 
 struct SccWorker
 {
@@ -35,69 +36,194 @@ struct SccWorker
 	RTLIL::Module *module;
 	SigMap sigmap;
 	CellTypes ct;
+	SigPool selectedSignals;
 
-	std::set<RTLIL::Cell*> workQueue;
-	std::map<RTLIL::Cell*, std::set<RTLIL::Cell*>> cellToNextCell;
-	std::map<RTLIL::Cell*, RTLIL::SigSpec> cellToPrevSig, cellToNextSig;
+	// the graph nodes are cells (or single output bits of cells in bit-level
+	// mode) in a dense index, the edges are stored in compressed sparse row
+	// form: the successors of node i are edgeTarget[edgeStart[i] .. edgeStart[i+1]-1]
+	std::vector<RTLIL::Cell*> nodeCell;
+	std::vector<RTLIL::SigBit> nodeBit;
+	std::vector<int> edgeStart, edgeTarget;
 
-	std::map<RTLIL::Cell*, std::pair<int, int>> cellLabels;
-	std::map<RTLIL::Cell*, int> cellDepth;
-	std::set<RTLIL::Cell*> cellsOnStack;
-	std::vector<RTLIL::Cell*> cellStack;
-	int labelCounter;
+	std::map<RTLIL::Cell*, RTLIL::SigSpec> cellToPrevSig, cellToNextSig;
 
 	std::map<RTLIL::Cell*, int> cell2scc;
 	std::vector<std::set<RTLIL::Cell*>> sccList;
+	std::vector<RTLIL::SigSpec> sccSignals;
 
-	void run(RTLIL::Cell *cell, int depth, int maxDepth)
+	void run(int maxDepth, bool bitLevel)
 	{
-		assert(workQueue.count(cell) > 0);
+		int numNodes = nodeCell.size();
+		std::vector<int> nodeIndex(numNodes, -1), nodeLowlink(numNodes), nodeDepth(numNodes);
+		std::vector<bool> nodeOnStack(numNodes);
+		std::vector<int> nodeStack;
+		int labelCounter = 0;
+
+		// explicit DFS stack of (node, next edge) pairs, so that long paths
+		// through the design can not overflow the C++ stack
+		std::vector<std::pair<int, int>> dfsStack;
+
+		for (int root = 0; root < numNodes; root++)
+		{
+			if (nodeIndex[root] >= 0)
+				continue;
 
-		workQueue.erase(cell);
-		cellLabels[cell] = std::pair<int, int>(labelCounter, labelCounter);
-		labelCounter++;
+			assert(nodeStack.size() == 0);
+			nodeIndex[root] = nodeLowlink[root] = labelCounter++;
+			nodeDepth[root] = 0;
+			nodeOnStack[root] = true;
+			nodeStack.push_back(root);
+			dfsStack.push_back(std::pair<int, int>(root, edgeStart[root]));
 
-		cellsOnStack.insert(cell);
-		cellStack.push_back(cell);
+			while (dfsStack.size() > 0)
+			{
+				int node = dfsStack.back().first;
+				int edge = dfsStack.back().second;
+
+				if (edge < edgeStart[node+1])
+				{
+					int next = edgeTarget[edge];
+					dfsStack.back().second++;
+
+					if (nodeIndex[next] < 0) {
+						nodeIndex[next] = nodeLowlink[next] = labelCounter++;
+						nodeDepth[next] = nodeDepth[node] + 1;
+						nodeOnStack[next] = true;
+						nodeStack.push_back(next);
+						dfsStack.push_back(std::pair<int, int>(next, edgeStart[next]));
+					} else
+					if (nodeOnStack[next] && (maxDepth < 0 || nodeDepth[next] + maxDepth > nodeDepth[node])) {
+						nodeLowlink[node] = std::min(nodeLowlink[node], nodeLowlink[next]);
+					}
+					continue;
+				}
 
-		if (maxDepth >= 0)
-			cellDepth[cell] = depth;
+				dfsStack.pop_back();
+
+				if (nodeIndex[node] == nodeLowlink[node])
+				{
+					if (nodeStack.back() == node)
+					{
+						nodeStack.pop_back();
+						nodeOnStack[node] = false;
+					}
+					else
+					{
+						log("Found an SCC:");
+						std::set<RTLIL::Cell*> scc;
+						RTLIL::SigSpec sig;
+						while (nodeOnStack[node]) {
+							int n = nodeStack.back();
+							nodeStack.pop_back();
+							nodeOnStack[n] = false;
+							if (bitLevel)
+								sig.append(nodeBit[n]);
+							RTLIL::Cell *c = nodeCell[n];
+							if (scc.count(c) > 0)
+								continue;
+							log(" %s", RTLIL::id2cstr(c->name));
+							cell2scc[c] = sccList.size();
+							scc.insert(c);
+						}
+						sig.sort_and_unify();
+						sccList.push_back(scc);
+						sccSignals.push_back(sig);
+						log("\n");
+					}
+				}
 
-		for (auto nextCell : cellToNextCell[cell])
-			if (cellLabels.count(nextCell) == 0) {
-				run(nextCell, depth+1, maxDepth);
-				cellLabels[cell].second = std::min(cellLabels[cell].second, cellLabels[nextCell].second);
-			} else
-			if (cellsOnStack.count(nextCell) > 0 && (maxDepth < 0 || cellDepth[nextCell] + maxDepth > depth)) {
-					cellLabels[cell].second = std::min(cellLabels[cell].second, cellLabels[nextCell].second);
+				if (dfsStack.size() > 0) {
+					int parent = dfsStack.back().first;
+					nodeLowlink[parent] = std::min(nodeLowlink[parent], nodeLowlink[node]);
+				}
 			}
+		}
+	}
 
-		if (cellLabels[cell].first == cellLabels[cell].second)
+	static RTLIL::SigSpec extendBit(const RTLIL::SigSpec &sig, int i, bool is_signed)
+	{
+		if (i < sig.width)
+			return sig.extract(i, 1);
+		if (is_signed && sig.width > 0)
+			return sig.extract(sig.width-1, 1);
+		return RTLIL::SigSpec();
+	}
+
+	// for each output bit of the cell, the input bits it depends on. Unknown
+	// dependencies are modeled conservatively by letting every output bit
+	// depend on every input bit.
+	void getBitDeps(RTLIL::Cell *cell, std::vector<std::pair<RTLIL::SigBit, RTLIL::SigSpec>> &deps)
+	{
+		if (cell->type.substr(0, 2) != "$_" && cell->connections.count("\\Y") > 0)
 		{
-			if (cellStack.back() == cell)
-			{
-				cellStack.pop_back();
-				cellsOnStack.erase(cell);
+			RTLIL::SigSpec sig_a, sig_b, sig_s, sig_y = sigmap(cell->connections.at("\\Y"));
+			bool signed_a = false, signed_b = false;
+
+			if (cell->connections.count("\\A") > 0)
+				sig_a = sigmap(cell->connections.at("\\A"));
+			if (cell->connections.count("\\B") > 0)
+				sig_b = sigmap(cell->connections.at("\\B"));
+			if (cell->connections.count("\\S") > 0)
+				sig_s = sigmap(cell->connections.at("\\S"));
+			if (cell->parameters.count("\\A_SIGNED") > 0)
+				signed_a = cell->parameters.at("\\A_SIGNED").as_bool();
+			if (cell->parameters.count("\\B_SIGNED") > 0)
+				signed_b = cell->parameters.at("\\B_SIGNED").as_bool();
+
+			if (cell->type == "$not" || cell->type == "$pos" || cell->type == "$bu0" || cell->type == "$and" ||
+					cell->type == "$or" || cell->type == "$xor" || cell->type == "$xnor") {
+				for (int i = 0; i < sig_y.width; i++) {
+					RTLIL::SigSpec sig = extendBit(sig_a, i, signed_a && cell->type != "$bu0");
+					sig.append(extendBit(sig_b, i, signed_b));
+					deps.push_back(std::pair<RTLIL::SigBit, RTLIL::SigSpec>(sig_y.extract(i, 1), sig));
+				}
+				return;
 			}
-			else
-			{
-				log("Found an SCC:");
-				std::set<RTLIL::Cell*> scc;
-				while (cellsOnStack.count(cell) > 0) {
-					RTLIL::Cell *c = cellStack.back();
-					cellStack.pop_back();
-					cellsOnStack.erase(c);
-					log(" %s", RTLIL::id2cstr(c->name));
-					cell2scc[c] = sccList.size();
-					scc.insert(c);
+
+			if (cell->type == "$add" || cell->type == "$sub" || cell->type == "$neg") {
+				RTLIL::SigSpec sig;
+				for (int i = 0; i < sig_y.width; i++) {
+					sig.append(extendBit(sig_a, i, signed_a));
+					sig.append(extendBit(sig_b, i, signed_b));
+					deps.push_back(std::pair<RTLIL::SigBit, RTLIL::SigSpec>(sig_y.extract(i, 1), sig));
+				}
+				return;
+			}
+
+			if (cell->type == "$mux" || cell->type == "$pmux" || cell->type == "$safe_pmux") {
+				for (int i = 0; i < sig_y.width; i++) {
+					RTLIL::SigSpec sig = sig_s;
+					sig.append(extendBit(sig_a, i, false));
+					for (int j = i; j < sig_b.width; j += sig_y.width)
+						sig.append(sig_b.extract(j, 1));
+					deps.push_back(std::pair<RTLIL::SigBit, RTLIL::SigSpec>(sig_y.extract(i, 1), sig));
 				}
-				sccList.push_back(scc);
-				log("\n");
+				return;
 			}
 		}
+
+		RTLIL::SigSpec inputSignals, outputSignals;
+
+		for (auto &conn : cell->connections)
+		{
+			bool isInput = true, isOutput = true;
+
+			if (ct.cell_known(cell->type)) {
+				isInput = ct.cell_input(cell->type, conn.first);
+				isOutput = ct.cell_output(cell->type, conn.first);
+			}
+
+			if (isInput)
+				inputSignals.append(sigmap(conn.second));
+			if (isOutput)
+				outputSignals.append(sigmap(conn.second));
+		}
+
+		for (auto &bit : outputSignals.to_sigbit_vector())
+			deps.push_back(std::pair<RTLIL::SigBit, RTLIL::SigSpec>(bit, inputSignals));
 	}
 
-	SccWorker(RTLIL::Design *design, RTLIL::Module *module, bool allCellTypes, int maxDepth) : design(design), module(module), sigmap(module)
+	SccWorker(RTLIL::Design *design, RTLIL::Module *module, bool allCellTypes, int maxDepth, bool bitLevel) : design(design), module(module), sigmap(module)
 	{
 		if (module->processes.size() > 0) {
 			log("Skipping module %s as it contains processes (run 'proc' pass first).\n", module->name.c_str());
@@ -111,8 +237,7 @@ struct SccWorker
 			ct.setup_stdcells();
 		}
 
-		SigPool selectedSignals;
-		SigSet<RTLIL::Cell*> sigToNextCells;
+		SigSet<int> sigToNextNodes;
 
 		for (auto &it : module->wires)
 			if (design->selected(module, it.second))
@@ -128,8 +253,6 @@ struct SccWorker
 			if (!allCellTypes && !ct.cell_known(cell->type))
 				continue;
 
-			workQueue.insert(cell);
-
 			RTLIL::SigSpec inputSignals, outputSignals;
 
 			for (auto &conn : cell->connections)
@@ -155,26 +278,45 @@ struct SccWorker
 
 			cellToPrevSig[cell] = inputSignals;
 			cellToNextSig[cell] = outputSignals;
-			sigToNextCells.insert(inputSignals, cell);
-		}
 
-		for (auto cell : workQueue)
-			cellToNextCell[cell] = sigToNextCells.find(cellToNextSig[cell]);
+			if (!bitLevel) {
+				sigToNextNodes.insert(inputSignals, nodeCell.size());
+				nodeCell.push_back(cell);
+				continue;
+			}
 
-		labelCounter = 0;
-		cellLabels.clear();
+			std::vector<std::pair<RTLIL::SigBit, RTLIL::SigSpec>> deps;
+			std::map<RTLIL::SigBit, int> bitToNode;
+			getBitDeps(cell, deps);
 
-		while (workQueue.size() > 0) {
-			RTLIL::Cell *cell = *workQueue.begin();
-			assert(cellStack.size() == 0);
-			cellDepth.clear();
-			run(cell, 0, maxDepth);
+			for (auto &dep : deps)
+			{
+				if (dep.first.wire == NULL || !selectedSignals.check_any(dep.first))
+					continue;
+
+				if (bitToNode.count(dep.first) == 0) {
+					bitToNode[dep.first] = nodeCell.size();
+					nodeCell.push_back(cell);
+					nodeBit.push_back(dep.first);
+				}
+
+				sigToNextNodes.insert(selectedSignals.extract(dep.second), bitToNode.at(dep.first));
+			}
+		}
+
+		edgeStart.push_back(0);
+		for (int i = 0; i < int(nodeCell.size()); i++) {
+			for (int next : sigToNextNodes.find(bitLevel ? RTLIL::SigSpec(nodeBit[i]) : cellToNextSig[nodeCell[i]]))
+				edgeTarget.push_back(next);
+			edgeStart.push_back(edgeTarget.size());
 		}
 
+		run(maxDepth, bitLevel);
+
 		log("Found %d SCCs in module %s.\n", int(sccList.size()), RTLIL::id2cstr(module->name));
 	}
 
-	void select(RTLIL::Selection &sel)
+	void select(RTLIL::Selection &sel, bool bitLevel)
 	{
 		for (int i = 0; i < int(sccList.size()); i++)
 		{
@@ -187,9 +329,13 @@ struct SccWorker
 				nextsig.append(cellToNextSig[cell]);
 			}
 
-			prevsig.sort_and_unify();
-			nextsig.sort_and_unify();
-			sig = prevsig.extract(nextsig);
+			if (bitLevel) {
+				sig = sccSignals[i];
+			} else {
+				prevsig.sort_and_unify();
+				nextsig.sort_and_unify();
+				sig = prevsig.extract(nextsig);
+			}
 
 			for (auto &chunk : sig.chunks)
 				if (chunk.wire != NULL)
@@ -214,6 +360,14 @@ struct SccPass : public Pass {
 		log("        e.g. be useful in identifying local loops in a module that turns out\n");
 		log("        to be one gigantic SCC.\n");
 		log("\n");
+		log("    -bit_level\n");
+		log("        track the loops on the level of individual signal bits instead of whole\n");
+		log("        cells. This avoids reporting false loops through multi-bit cells, e.g.\n");
+		log("        two $and cells where bit 0 of the output of each cell drives bit 1 of\n");
+		log("        the input of the other cell. Cells for which the bit-level dependencies\n");
+		log("        are not known are treated as if every output bit depends on every input\n");
+		log("        bit.\n");
+		log("\n");
 		log("    -all_cell_types\n");
 		log("        Usually this command only considers internal non-memory cells. With\n");
 		log("        this option set, all cells are considered. For unkown cells all ports\n");
@@ -236,6 +390,7 @@ struct SccPass : public Pass {
 		std::map<std::string, std::string> setCellAttr, setWireAttr;
 		bool allCellTypes = false;
 		bool selectMode = false;
+		bool bitLevel = false;
 		int maxDepth = -1;
 
 		log_header("Executing SCC pass (detecting logic loops).\n");
@@ -246,6 +401,10 @@ struct SccPass : public Pass {
 				maxDepth = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-bit_level") {
+				bitLevel = true;
+				continue;
+			}
 			if (args[argidx] == "-all_cell_types") {
 				allCellTypes = true;
 				continue;
@@ -283,10 +442,10 @@ struct SccPass : public Pass {
 		for (auto &mod_it : design->modules)
 			if (design->selected(mod_it.second))
 			{
-				SccWorker worker(design, mod_it.second, allCellTypes, maxDepth);
+				SccWorker worker(design, mod_it.second, allCellTypes, maxDepth, bitLevel);
 
 				if (selectMode)
-					worker.select(newSelection);
+					worker.select(newSelection, bitLevel);
 			}
 
 		if (selectMode) {
@@ -27,12 +27,15 @@
 #include "kernel/sigtools.h"
 #include "kernel/consteval.h"
 #include "kernel/celltypes.h"
+#include "kernel/satgen.h"
 #include "fsmdata.h"
 
 static RTLIL::Module *module;
 static SigMap assign_map;
 typedef std::pair<std::string, std::string> sig2driver_entry_t;
 static SigSet<sig2driver_entry_t> sig2driver, sig2trigger;
+static CellTypes comb_ct;
+static int sat_min_inputs;
 
 static bool find_states(RTLIL::SigSpec sig, const RTLIL::SigSpec &dff_out, RTLIL::SigSpec &ctrl, std::map<RTLIL::Const, int> &states, RTLIL::Const *reset_state = NULL)
 {
@@ -174,6 +177,181 @@ static void find_transitions(ConstEval &ce, ConstEval &ce_nostop, FsmData &fsm_d
 	}
 }
 
+static void log_transition(FsmData &fsm_data, FsmData::transition_t &tr, RTLIL::Const next_state, bool ignored)
+{
+	RTLIL::Const log_state_in = RTLIL::Const(RTLIL::State::Sx, fsm_data.state_bits);
+	if (tr.state_in >= 0)
+		log_state_in = fsm_data.state_table[tr.state_in];
+	log("  transition: %10s %s -> %10s %s%s\n", log_signal(log_state_in), log_signal(tr.ctrl_in),
+			log_signal(next_state), log_signal(tr.ctrl_out), ignored ? "  <ignored undef transistion!>" : "");
+}
+
+// SAT based alternative to find_transitions(): the next state and control
+// outputs are modelled as functions of the control inputs for the given
+// state. each model of the SAT problem is generalized to a cube of control
+// inputs by removing all inputs that neither change the outputs nor make the
+// cube overlap with an already found cube, then the next model outside of
+// all found cubes is searched. the number of SAT calls is proportional to the
+// number of cubes times the number of inputs.
+static bool find_transitions_sat(ConstEval &ce_nostop, FsmData &fsm_data, std::map<RTLIL::Const, int> &states, int state_in, RTLIL::SigSpec ctrl_in, RTLIL::SigSpec ctrl_out, RTLIL::SigSpec dff_in, RTLIL::SigSpec dff_out)
+{
+	ezDefaultSAT ez;
+	SatGen satgen(&ez, &assign_map);
+	satgen.model_undef = true;
+
+	// control inputs that only depend on the state are don't-care inputs of
+	// the FSM, their value is set in the SAT problem
+	std::vector<int> free_inputs;
+	RTLIL::SigSpec fixed_sig;
+	RTLIL::Const fixed_val;
+	for (int i = 0; i < ctrl_in.width; i++) {
+		RTLIL::SigSpec bit = ctrl_in.extract(i, 1);
+		if (ce_nostop.eval(bit)) {
+			fixed_sig.append(ctrl_in.extract(i, 1));
+			fixed_val.bits.push_back(bit.as_const().bits.at(0));
+		} else
+			free_inputs.push_back(i);
+	}
+
+	// import the logic between the state register and control inputs and
+	// the next state and control outputs
+	SigPool stop_bits, visited_bits;
+	std::set<RTLIL::Cell*> visited_cells;
+	stop_bits.add(assign_map(dff_out));
+	stop_bits.add(assign_map(ctrl_in));
+
+	std::vector<RTLIL::SigSpec> queue;
+	queue.push_back(dff_in);
+	queue.push_back(ctrl_out);
+	while (!queue.empty())
+	{
+		RTLIL::SigSpec sig = assign_map(queue.back());
+		queue.pop_back();
+
+		sig.expand();
+		for (auto &c : sig.chunks)
+		{
+			if (c.wire == NULL || stop_bits.check_any(c) || visited_bits.check_any(c))
+				continue;
+			visited_bits.add(c);
+
+			std::set<sig2driver_entry_t> cellport_list;
+			sig2driver.find(c, cellport_list);
+			for (auto &cellport : cellport_list) {
+				RTLIL::Cell *cell = module->cells.at(cellport.first);
+				if (visited_cells.count(cell) || !comb_ct.cell_known(cell->type))
+					continue;
+				visited_cells.insert(cell);
+				if (!satgen.importCell(cell)) {
+					log("  cell %s (%s) can't be imported into the SAT problem.\n", cell->name.c_str(), cell->type.c_str());
+					return false;
+				}
+				for (auto &conn : cell->connections)
+					if (comb_ct.cell_input(cell->type, conn.first))
+						queue.push_back(conn.second);
+			}
+		}
+	}
+
+	auto set_signal = [&](RTLIL::SigSpec sig, RTLIL::Const value) {
+		std::vector<int> def = satgen.importDefSigSpec(sig), undef = satgen.importUndefSigSpec(sig);
+		for (size_t i = 0; i < def.size(); i++) {
+			bool bit_undef = value.bits[i] != RTLIL::State::S0 && value.bits[i] != RTLIL::State::S1;
+			ez.assume(bit_undef ? undef[i] : ez.NOT(undef[i]));
+			if (!bit_undef)
+				ez.assume(value.bits[i] == RTLIL::State::S1 ? def[i] : ez.NOT(def[i]));
+		}
+	};
+
+	set_signal(dff_out, fsm_data.state_table[state_in]);
+	set_signal(fixed_sig, fixed_val);
+
+	std::vector<int> input_lits;
+	for (int i : free_inputs) {
+		RTLIL::SigSpec bit = ctrl_in.extract(i, 1);
+		input_lits.push_back(satgen.importDefSigSpec(bit).at(0));
+		ez.assume(ez.NOT(satgen.importUndefSigSpec(bit).at(0)));
+	}
+
+	// the outputs with undef bits forced to zero, followed by the undef bits
+	RTLIL::SigSpec out_sig = dff_in;
+	out_sig.append(ctrl_out);
+	std::vector<int> out_undef = satgen.importUndefSigSpec(out_sig);
+	std::vector<int> out_vec = ez.vec_and(satgen.importDefSigSpec(out_sig), ez.vec_not(out_undef));
+	out_vec.insert(out_vec.end(), out_undef.begin(), out_undef.end());
+
+	std::vector<int> model_expr = input_lits;
+	model_expr.insert(model_expr.end(), out_vec.begin(), out_vec.end());
+
+	std::vector<int> found_cubes;
+	std::vector<bool> model_values, dummy_values;
+
+	while (ez.solve(model_expr, model_values, ez.NOT(ez.expression(ezSAT::OpOr, found_cubes))))
+	{
+		std::vector<int> cube;
+		for (size_t i = 0; i < input_lits.size(); i++)
+			cube.push_back(model_values[i] ? input_lits[i] : ez.NOT(input_lits[i]));
+
+		std::vector<bool> out_values(model_values.begin() + input_lits.size(), model_values.end());
+		int out_changed = ez.vec_ne(out_vec, ez.vec_const(out_values));
+		int cube_invalid = ez.OR(out_changed, ez.expression(ezSAT::OpOr, found_cubes));
+
+		std::vector<int> assumptions = cube;
+		assumptions.push_back(out_changed);
+		if (ez.solve(std::vector<int>(), dummy_values, assumptions)) {
+			log("  next state or control outputs depend on signals that are not control inputs.\n");
+			return false;
+		}
+
+		// remove each input from the cube that is not needed to keep the outputs
+		// constant and the cube disjoint from the previously found cubes
+		std::vector<bool> keep(cube.size(), true);
+		for (size_t i = 0; i < cube.size(); i++) {
+			keep[i] = false;
+			assumptions.clear();
+			for (size_t j = 0; j < cube.size(); j++)
+				if (keep[j])
+					assumptions.push_back(cube[j]);
+			assumptions.push_back(cube_invalid);
+			if (ez.solve(std::vector<int>(), dummy_values, assumptions))
+				keep[i] = true;
+		}
+
+		FsmData::transition_t tr;
+		tr.state_in = state_in;
+		tr.ctrl_in = RTLIL::Const(RTLIL::State::Sa, ctrl_in.width);
+		tr.ctrl_out = RTLIL::Const(RTLIL::State::Sx, ctrl_out.width);
+
+		std::vector<int> cube_lits;
+		for (size_t i = 0; i < cube.size(); i++)
+			if (keep[i]) {
+				tr.ctrl_in.bits[free_inputs[i]] = model_values[i] ? RTLIL::State::S1 : RTLIL::State::S0;
+				cube_lits.push_back(cube[i]);
+			}
+
+		int width = out_sig.width;
+		RTLIL::Const next_state;
+		bool next_state_undef = false;
+		for (int i = 0; i < width; i++) {
+			RTLIL::State bit = out_values[width + i] ? RTLIL::State::Sx : out_values[i] ? RTLIL::State::S1 : RTLIL::State::S0;
+			if (i < dff_in.width) {
+				next_state.bits.push_back(bit);
+				next_state_undef = next_state_undef || bit == RTLIL::State::Sx;
+			} else
+				tr.ctrl_out.bits[i - dff_in.width] = bit;
+		}
+
+		tr.state_out = states.count(next_state) ? states.at(next_state) : -1;
+		if (!next_state_undef)
+			fsm_data.transition_table.push_back(tr);
+		log_transition(fsm_data, tr, next_state, next_state_undef);
+
+		found_cubes.push_back(ez.expression(ezSAT::OpAnd, cube_lits));
+	}
+
+	return true;
+}
+
 static void extract_fsm(RTLIL::Wire *wire)
 {
 	log("Extracting FSM `%s' from module `%s'.\n", wire->name.c_str(), module->name.c_str());
@@ -273,12 +451,34 @@ static void extract_fsm(RTLIL::Wire *wire)
 
 	ConstEval ce(module), ce_nostop(module);
 	ce.stop(ctrl_in);
-	for (int state_idx = 0; state_idx < int(fsm_data.state_table.size()); state_idx++) {
-		ce.push(), ce_nostop.push();
-		ce.set(dff_out, fsm_data.state_table[state_idx]);
-		ce_nostop.set(dff_out, fsm_data.state_table[state_idx]);
-		find_transitions(ce, ce_nostop, fsm_data, states, state_idx, ctrl_in, ctrl_out, dff_in, RTLIL::SigSpec());
-		ce.pop(), ce_nostop.pop();
+
+	bool use_sat = sat_min_inputs >= 0 && ctrl_in.width >= sat_min_inputs;
+	if (use_sat)
+	{
+		log("  using SAT solver to find transitions.\n");
+		for (int state_idx = 0; state_idx < int(fsm_data.state_table.size()); state_idx++) {
+			ce_nostop.push();
+			ce_nostop.set(dff_out, fsm_data.state_table[state_idx]);
+			bool ok = find_transitions_sat(ce_nostop, fsm_data, states, state_idx, ctrl_in, ctrl_out, dff_in, dff_out);
+			ce_nostop.pop();
+			if (!ok) {
+				log("  falling back to exhaustive search.\n");
+				fsm_data.transition_table.clear();
+				use_sat = false;
+				break;
+			}
+		}
+	}
+
+	if (!use_sat)
+	{
+		for (int state_idx = 0; state_idx < int(fsm_data.state_table.size()); state_idx++) {
+			ce.push(), ce_nostop.push();
+			ce.set(dff_out, fsm_data.state_table[state_idx]);
+			ce_nostop.set(dff_out, fsm_data.state_table[state_idx]);
+			find_transitions(ce, ce_nostop, fsm_data, states, state_idx, ctrl_in, ctrl_out, dff_in, RTLIL::SigSpec());
+			ce.pop(), ce_nostop.pop();
+		}
 	}
 
 	// create fsm cell
@@ -326,7 +526,7 @@ struct FsmExtractPass : public Pass {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    fsm_extract [selection]\n");
+		log("    fsm_extract [options] [selection]\n");
 		log("\n");
 		log("This pass operates on all signals marked as FSM state signals using the\n");
 		log("'fsm_encoding' attribute. It consumes the logic that creates the state signal\n");
@@ -337,11 +537,41 @@ struct FsmExtractPass : public Pass {
 		log("original encoding. The 'fsm_opt' pass can be used in combination with the\n");
 		log("'opt_clean' pass to eliminate this signal.\n");
 		log("\n");
+		log("By default the transitions are found by evaluating the next state logic for\n");
+		log("each combination of the control inputs it depends on. For FSMs with 12 or\n");
+		log("more control inputs a SAT solver is used instead, that enumerates cubes of\n");
+		log("control inputs with the same next state and control outputs.\n");
+		log("\n");
+		log("    -sat\n");
+		log("        always use the SAT solver to find the transitions\n");
+		log("\n");
+		log("    -nosat\n");
+		log("        never use the SAT solver to find the transitions\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
 		log_header("Executing FSM_EXTRACT pass (extracting FSM from design).\n");
-		extra_args(args, 1, design);
+
+		sat_min_inputs = 12;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-sat") {
+				sat_min_inputs = 0;
+				continue;
+			}
+			if (args[argidx] == "-nosat") {
+				sat_min_inputs = -1;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		comb_ct.clear();
+		comb_ct.setup_internals();
+		comb_ct.setup_stdcells();
 
 		CellTypes ct;
 		ct.setup_internals();
@@ -386,6 +616,7 @@ struct FsmExtractPass : public Pass {
 		assign_map.clear();
 		sig2driver.clear();
 		sig2trigger.clear();
+		comb_ct.clear();
 	}
 } FsmExtractPass;
  
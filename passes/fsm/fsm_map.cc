@@ -25,119 +25,316 @@
 #include "fsmdata.h"
 #include <string.h>
 
-static void implement_pattern_cache(RTLIL::Module *module, std::map<RTLIL::Const, std::set<int>> &pattern_cache, std::set<int> &fullstate_cache, int num_states, RTLIL::Wire *state_onehot, RTLIL::SigSpec &ctrl_in, RTLIL::SigSpec output)
+// A product term over the FSM inputs: a pattern of CTRL_IN (S0, S1 or Sa for
+// bits that are not used) and the set of states in which the term is active.
+// A term is implemented as an $eq cell for the pattern and-ed with a
+// $reduce_or cell over the onehot bits of the states.
+struct FsmTerm
 {
-	RTLIL::SigSpec cases_vector;
+	std::vector<RTLIL::State> ctrl_in;
+	std::vector<bool> states;
 
-	for (int in_state : fullstate_cache)
-		cases_vector.append(RTLIL::SigSpec(state_onehot, 1, in_state));
+	bool operator<(const FsmTerm &other) const
+	{
+		if (ctrl_in != other.ctrl_in)
+			return ctrl_in < other.ctrl_in;
+		return states < other.states;
+	}
 
-	for (auto &it : pattern_cache)
+	bool intersects(const FsmTerm &other) const
 	{
-		RTLIL::Const pattern = it.first;
-		RTLIL::SigSpec eq_sig_a, eq_sig_b, or_sig;
+		for (size_t i = 0; i < ctrl_in.size(); i++)
+			if (ctrl_in[i] != RTLIL::State::Sa && other.ctrl_in[i] != RTLIL::State::Sa && ctrl_in[i] != other.ctrl_in[i])
+				return false;
+		for (size_t i = 0; i < states.size(); i++)
+			if (states[i] && other.states[i])
+				return true;
+		return false;
+	}
 
-		for (size_t j = 0; j < pattern.bits.size(); j++)
-			if (pattern.bits[j] == RTLIL::State::S0 || pattern.bits[j] == RTLIL::State::S1) {
-				eq_sig_a.append(ctrl_in.extract(j, 1));
-				eq_sig_b.append(RTLIL::SigSpec(pattern.bits[j]));
-			}
-		eq_sig_a.optimize();
-		eq_sig_b.optimize();
+	bool contains(const FsmTerm &other) const
+	{
+		for (size_t i = 0; i < ctrl_in.size(); i++)
+			if (ctrl_in[i] != RTLIL::State::Sa && ctrl_in[i] != other.ctrl_in[i])
+				return false;
+		for (size_t i = 0; i < states.size(); i++)
+			if (other.states[i] && !states[i])
+				return false;
+		return true;
+	}
+
+	int num_literals() const
+	{
+		int count = 0;
+		for (auto bit : ctrl_in)
+			if (bit != RTLIL::State::Sa)
+				count++;
+		for (auto bit : states)
+			if (bit)
+				count++;
+		return count;
+	}
+};
+
+// Two-level minimization of a single output function of the FSM in the style
+// of espresso: each term of the on-set is expanded to a prime implicant (that
+// does not intersect the off-set), then a small set of primes that covers the
+// on-set is selected. Input patterns that are not in the transition table are
+// don't-cares. Terms that are already implemented for other outputs of the
+// same FSM are preferred when selecting the cover.
+static std::vector<FsmTerm> minimize_terms(const std::vector<FsmTerm> &on_set, const std::vector<FsmTerm> &off_set, const std::map<FsmTerm, RTLIL::SigSpec> &term_cache)
+{
+	std::set<FsmTerm> primes_set;
+
+	for (auto term : on_set)
+	{
+		// first remove input literals, as they are more expensive than the
+		// states (that are just an or over the onehot state bits)
+		for (size_t i = 0; i < term.ctrl_in.size(); i++) {
+			if (term.ctrl_in[i] == RTLIL::State::Sa)
+				continue;
+			RTLIL::State old_bit = term.ctrl_in[i];
+			term.ctrl_in[i] = RTLIL::State::Sa;
+			for (auto &off : off_set)
+				if (term.intersects(off)) {
+					term.ctrl_in[i] = old_bit;
+					break;
+				}
+		}
+
+		for (size_t i = 0; i < term.states.size(); i++) {
+			if (term.states[i])
+				continue;
+			term.states[i] = true;
+			for (auto &off : off_set)
+				if (term.intersects(off)) {
+					term.states[i] = false;
+					break;
+				}
+		}
+
+		primes_set.insert(term);
+	}
+
+	std::vector<FsmTerm> primes(primes_set.begin(), primes_set.end());
+	std::vector<std::vector<int>> prime_covers(primes.size());
+	for (size_t i = 0; i < primes.size(); i++)
+		for (size_t j = 0; j < on_set.size(); j++)
+			if (primes[i].contains(on_set[j]))
+				prime_covers[i].push_back(j);
 
-		for (int in_state : it.second)
-			if (fullstate_cache.count(in_state) == 0)
-				or_sig.append(RTLIL::SigSpec(state_onehot, 1, in_state));
-		or_sig.optimize();
+	// greedy set cover
+	std::vector<bool> covered(on_set.size());
+	std::vector<bool> selected(primes.size());
+	std::vector<FsmTerm> result;
 
-		if (or_sig.width == 0)
+	while (1)
+	{
+		int best_idx = -1, best_count = 0, best_cost = 0;
+
+		for (size_t i = 0; i < primes.size(); i++) {
+			if (selected[i])
+				continue;
+			int count = 0;
+			for (int j : prime_covers[i])
+				if (!covered[j])
+					count++;
+			if (count == 0)
+				continue;
+			int cost = term_cache.count(primes[i]) ? 0 : primes[i].num_literals() + 1;
+			if (best_idx < 0 || count > best_count || (count == best_count && cost < best_cost))
+				best_idx = i, best_count = count, best_cost = cost;
+		}
+
+		if (best_idx < 0)
+			break;
+
+		selected[best_idx] = true;
+		for (int j : prime_covers[best_idx])
+			covered[j] = true;
+	}
+
+	// remove selected primes that only cover terms that are also covered by
+	// other selected primes
+	std::vector<int> cover_count(on_set.size());
+	for (size_t i = 0; i < primes.size(); i++)
+		if (selected[i])
+			for (int j : prime_covers[i])
+				cover_count[j]++;
+
+	for (size_t i = 0; i < primes.size(); i++) {
+		if (!selected[i])
 			continue;
+		bool redundant = true;
+		for (int j : prime_covers[i])
+			if (cover_count[j] == 1)
+				redundant = false;
+		if (redundant) {
+			selected[i] = false;
+			for (int j : prime_covers[i])
+				cover_count[j]--;
+		} else
+			result.push_back(primes[i]);
+	}
 
-		RTLIL::SigSpec and_sig;
+	return result;
+}
 
-		if (eq_sig_a.width > 0)
-		{
-			RTLIL::Wire *eq_wire = new RTLIL::Wire;
-			eq_wire->name = NEW_ID;
-			module->add(eq_wire);
+static RTLIL::SigSpec implement_term(RTLIL::Module *module, const FsmTerm &term, std::map<FsmTerm, RTLIL::SigSpec> &term_cache, RTLIL::Wire *state_onehot, RTLIL::SigSpec &ctrl_in)
+{
+	if (term_cache.count(term))
+		return term_cache.at(term);
 
-			RTLIL::Cell *eq_cell = new RTLIL::Cell;
-			eq_cell->name = NEW_ID;
-			eq_cell->type = "$eq";
-			eq_cell->connections["\\A"] = eq_sig_a;
-			eq_cell->connections["\\B"] = eq_sig_b;
-			eq_cell->connections["\\Y"] = RTLIL::SigSpec(eq_wire);
-			eq_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
-			eq_cell->parameters["\\B_SIGNED"] = RTLIL::Const(false);
-			eq_cell->parameters["\\A_WIDTH"] = RTLIL::Const(eq_sig_a.width);
-			eq_cell->parameters["\\B_WIDTH"] = RTLIL::Const(eq_sig_b.width);
-			eq_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
-			module->add(eq_cell);
+	RTLIL::SigSpec eq_sig_a, eq_sig_b, or_sig;
 
-			and_sig.append(RTLIL::SigSpec(eq_wire));
+	for (size_t j = 0; j < term.ctrl_in.size(); j++)
+		if (term.ctrl_in[j] == RTLIL::State::S0 || term.ctrl_in[j] == RTLIL::State::S1) {
+			eq_sig_a.append(ctrl_in.extract(j, 1));
+			eq_sig_b.append(RTLIL::SigSpec(term.ctrl_in[j]));
 		}
+	eq_sig_a.optimize();
+	eq_sig_b.optimize();
+
+	bool all_states = true;
+	for (size_t j = 0; j < term.states.size(); j++)
+		if (term.states[j])
+			or_sig.append(RTLIL::SigSpec(state_onehot, 1, j));
+		else
+			all_states = false;
+	or_sig.optimize();
+
+	RTLIL::SigSpec and_sig;
 
-		if (or_sig.width < num_states-int(fullstate_cache.size()))
+	if (eq_sig_a.width > 0)
+	{
+		RTLIL::Wire *eq_wire = new RTLIL::Wire;
+		eq_wire->name = NEW_ID;
+		module->add(eq_wire);
+
+		RTLIL::Cell *eq_cell = new RTLIL::Cell;
+		eq_cell->name = NEW_ID;
+		eq_cell->type = "$eq";
+		eq_cell->connections["\\A"] = eq_sig_a;
+		eq_cell->connections["\\B"] = eq_sig_b;
+		eq_cell->connections["\\Y"] = RTLIL::SigSpec(eq_wire);
+		eq_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
+		eq_cell->parameters["\\B_SIGNED"] = RTLIL::Const(false);
+		eq_cell->parameters["\\A_WIDTH"] = RTLIL::Const(eq_sig_a.width);
+		eq_cell->parameters["\\B_WIDTH"] = RTLIL::Const(eq_sig_b.width);
+		eq_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+		module->add(eq_cell);
+
+		and_sig.append(RTLIL::SigSpec(eq_wire));
+	}
+
+	if (!all_states)
+	{
+		if (or_sig.width == 1)
 		{
-			if (or_sig.width == 1)
-			{
-				and_sig.append(or_sig);
-			}
-			else
-			{
-				RTLIL::Wire *or_wire = new RTLIL::Wire;
-				or_wire->name = NEW_ID;
-				module->add(or_wire);
-
-				RTLIL::Cell *or_cell = new RTLIL::Cell;
-				or_cell->name = NEW_ID;
-				or_cell->type = "$reduce_or";
-				or_cell->connections["\\A"] = or_sig;
-				or_cell->connections["\\Y"] = RTLIL::SigSpec(or_wire);
-				or_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
-				or_cell->parameters["\\A_WIDTH"] = RTLIL::Const(or_sig.width);
-				or_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
-				module->add(or_cell);
-
-				and_sig.append(RTLIL::SigSpec(or_wire));
-			}
+			and_sig.append(or_sig);
 		}
+		else
+		{
+			RTLIL::Wire *or_wire = new RTLIL::Wire;
+			or_wire->name = NEW_ID;
+			module->add(or_wire);
+
+			RTLIL::Cell *or_cell = new RTLIL::Cell;
+			or_cell->name = NEW_ID;
+			or_cell->type = "$reduce_or";
+			or_cell->connections["\\A"] = or_sig;
+			or_cell->connections["\\Y"] = RTLIL::SigSpec(or_wire);
+			or_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
+			or_cell->parameters["\\A_WIDTH"] = RTLIL::Const(or_sig.width);
+			or_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+			module->add(or_cell);
+
+			and_sig.append(RTLIL::SigSpec(or_wire));
+		}
+	}
+
+	RTLIL::SigSpec result;
 
-		switch (and_sig.width)
+	switch (and_sig.width)
+	{
+	case 2:
 		{
-		case 2:
-			{
-				RTLIL::Wire *and_wire = new RTLIL::Wire;
-				and_wire->name = NEW_ID;
-				module->add(and_wire);
-
-				RTLIL::Cell *and_cell = new RTLIL::Cell;
-				and_cell->name = NEW_ID;
-				and_cell->type = "$and";
-				and_cell->connections["\\A"] = and_sig.extract(0, 1);
-				and_cell->connections["\\B"] = and_sig.extract(1, 1);
-				and_cell->connections["\\Y"] = RTLIL::SigSpec(and_wire);
-				and_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
-				and_cell->parameters["\\B_SIGNED"] = RTLIL::Const(false);
-				and_cell->parameters["\\A_WIDTH"] = RTLIL::Const(1);
-				and_cell->parameters["\\B_WIDTH"] = RTLIL::Const(1);
-				and_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
-				module->add(and_cell);
-
-				cases_vector.append(RTLIL::SigSpec(and_wire));
-				break;
-			}
-		case 1:
-			cases_vector.append(and_sig);
-			break;
-		case 0:
-			cases_vector.append(RTLIL::SigSpec(1, 1));
+			RTLIL::Wire *and_wire = new RTLIL::Wire;
+			and_wire->name = NEW_ID;
+			module->add(and_wire);
+
+			RTLIL::Cell *and_cell = new RTLIL::Cell;
+			and_cell->name = NEW_ID;
+			and_cell->type = "$and";
+			and_cell->connections["\\A"] = and_sig.extract(0, 1);
+			and_cell->connections["\\B"] = and_sig.extract(1, 1);
+			and_cell->connections["\\Y"] = RTLIL::SigSpec(and_wire);
+			and_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
+			and_cell->parameters["\\B_SIGNED"] = RTLIL::Const(false);
+			and_cell->parameters["\\A_WIDTH"] = RTLIL::Const(1);
+			and_cell->parameters["\\B_WIDTH"] = RTLIL::Const(1);
+			and_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+			module->add(and_cell);
+
+			result = RTLIL::SigSpec(and_wire);
 			break;
-		default:
-			log_abort();
 		}
+	case 1:
+		result = and_sig;
+		break;
+	case 0:
+		result = RTLIL::SigSpec(1, 1);
+		break;
+	default:
+		log_abort();
 	}
 
+	term_cache[term] = result;
+	return result;
+}
+
+// output_values[i] is the value of the output in transition i (S0, S1 or a
+// don't-care value)
+static void implement_function(RTLIL::Module *module, FsmData &fsm_data, const std::vector<RTLIL::State> &output_values, std::map<FsmTerm, RTLIL::SigSpec> &term_cache, RTLIL::Wire *state_onehot, RTLIL::SigSpec &ctrl_in, RTLIL::SigSpec output)
+{
+	std::map<std::vector<RTLIL::State>, std::vector<bool>> on_patterns;
+	std::vector<FsmTerm> on_set, off_set;
+
+	for (size_t i = 0; i < fsm_data.transition_table.size(); i++)
+	{
+		FsmData::transition_t &tr = fsm_data.transition_table[i];
+		if (tr.state_in < 0 || (output_values[i] != RTLIL::State::S0 && output_values[i] != RTLIL::State::S1))
+			continue;
+
+		std::vector<RTLIL::State> pattern = tr.ctrl_in.bits;
+		for (auto &bit : pattern)
+			if (bit != RTLIL::State::S0 && bit != RTLIL::State::S1)
+				bit = RTLIL::State::Sa;
+
+		if (output_values[i] == RTLIL::State::S1) {
+			std::vector<bool> &states = on_patterns[pattern];
+			states.resize(fsm_data.state_table.size());
+			states[tr.state_in] = true;
+		} else {
+			FsmTerm term;
+			term.ctrl_in = pattern;
+			term.states.resize(fsm_data.state_table.size());
+			term.states[tr.state_in] = true;
+			off_set.push_back(term);
+		}
+	}
+
+	for (auto &it : on_patterns) {
+		FsmTerm term;
+		term.ctrl_in = it.first;
+		term.states = it.second;
+		on_set.push_back(term);
+	}
+
+	RTLIL::SigSpec cases_vector;
+	for (auto &term : minimize_terms(on_set, off_set, term_cache))
+		cases_vector.append(implement_term(module, term, term_cache, state_onehot, ctrl_in));
+
 	if (cases_vector.width > 1) {
 		RTLIL::Cell *or_cell = new RTLIL::Cell;
 		or_cell->name = NEW_ID;
@@ -251,22 +448,16 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 	next_state_onehot->width = fsm_data.state_table.size();
 	module->add(next_state_onehot);
 
+	// product terms are shared between all next state and output functions
+	std::map<FsmTerm, RTLIL::SigSpec> term_cache;
+
 	for (size_t i = 0; i < fsm_data.state_table.size(); i++)
 	{
-		std::map<RTLIL::Const, std::set<int>> pattern_cache;
-		std::set<int> fullstate_cache;
-
-		for (size_t j = 0; j < fsm_data.state_table.size(); j++)
-			fullstate_cache.insert(j);
-
-		for (auto &tr : fsm_data.transition_table) {
-			if (tr.state_out == int(i))
-				pattern_cache[tr.ctrl_in].insert(tr.state_in);
-			else
-				fullstate_cache.erase(tr.state_in);
-		}
+		std::vector<RTLIL::State> output_values;
+		for (auto &tr : fsm_data.transition_table)
+			output_values.push_back(tr.state_out == int(i) ? RTLIL::State::S1 : RTLIL::State::S0);
 
-		implement_pattern_cache(module, pattern_cache, fullstate_cache, fsm_data.state_table.size(), state_onehot, ctrl_in, RTLIL::SigSpec(next_state_onehot, 1, i));
+		implement_function(module, fsm_data, output_values, term_cache, state_onehot, ctrl_in, RTLIL::SigSpec(next_state_onehot, 1, i));
 	}
 
 	if (encoding_is_onehot)
@@ -301,9 +492,12 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 			}
 		}
 
+		// next_state_onehot can only have more than one bit set for input
+		// combinations without a transition, which implement_function()
+		// treats as don't-care, so the checks of $safe_pmux are not needed
 		RTLIL::Cell *mux_cell = new RTLIL::Cell;
 		mux_cell->name = NEW_ID;
-		mux_cell->type = "$safe_pmux";
+		mux_cell->type = "$pmux";
 		mux_cell->connections["\\A"] = sig_a;
 		mux_cell->connections["\\B"] = sig_b;
 		mux_cell->connections["\\S"] = sig_s;
@@ -322,20 +516,11 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 
 	for (int i = 0; i < fsm_data.num_outputs; i++)
 	{
-		std::map<RTLIL::Const, std::set<int>> pattern_cache;
-		std::set<int> fullstate_cache;
-
-		for (size_t j = 0; j < fsm_data.state_table.size(); j++)
-			fullstate_cache.insert(j);
+		std::vector<RTLIL::State> output_values;
+		for (auto &tr : fsm_data.transition_table)
+			output_values.push_back(tr.ctrl_out.bits[i]);
 
-		for (auto &tr : fsm_data.transition_table) {
-			if (tr.ctrl_out.bits[i] == RTLIL::State::S1)
-				pattern_cache[tr.ctrl_in].insert(tr.state_in);
-			else
-				fullstate_cache.erase(tr.state_in);
-		}
-
-		implement_pattern_cache(module, pattern_cache, fullstate_cache, fsm_data.state_table.size(), state_onehot, ctrl_in, ctrl_out.extract(i, 1));
+		implement_function(module, fsm_data, output_values, term_cache, state_onehot, ctrl_in, ctrl_out.extract(i, 1));
 	}
 
 	// Remove FSM cell
@@ -352,7 +537,13 @@ struct FsmMapPass : public Pass {
 		log("\n");
 		log("    fsm_map [selection]\n");
 		log("\n");
-		log("This pass translates FSM cells to flip-flops and logic.\n");
+		log("This pass translates FSM cells to flip-flops and logic. The next state and\n");
+		log("output functions are minimized as sum-of-products over the FSM inputs and\n");
+		log("the decoded states, with product terms shared between all functions.\n");
+		log("\n");
+		log("Input combinations without a transition are treated as don't-care. For such\n");
+		log("inputs the next state is undefined, i.e. the FSM does not necessarily return\n");
+		log("to the reset state.\n");
 		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
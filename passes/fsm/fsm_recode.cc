@@ -26,6 +26,8 @@
 #include <math.h>
 #include <string.h>
 #include <errno.h>
+#include <atomic>
+#include <thread>
 
 static void fm_set_fsm_print(RTLIL::Cell *cell, RTLIL::Module *module, FsmData &fsm_data, const char *prefix, FILE *f)
 {
@@ -48,38 +50,104 @@ static void fm_set_fsm_print(RTLIL::Cell *cell, RTLIL::Module *module, FsmData &
 			prefix, RTLIL::unescape_id(module->name).c_str());
 }
 
-static void fsm_recode(RTLIL::Cell *cell, RTLIL::Module *module, FILE *fm_set_fsm_file, std::string default_encoding)
+static int popcount(int value)
 {
-	std::string encoding = cell->attributes.count("\\fsm_encoding") ? cell->attributes.at("\\fsm_encoding").decode_string() : "auto";
+	int count = 0;
+	for (; value != 0; value = value >> 1)
+		count += value & 1;
+	return count;
+}
 
-	log("Recoding FSM `%s' from module `%s' using `%s' encoding:\n", cell->name.c_str(), module->name.c_str(), encoding.c_str());
-	if (encoding != "none" && encoding != "one-hot" && encoding != "binary") {
-		if (encoding != "auto")
-			log("  unkown encoding `%s': using auto (%s) instead.\n", encoding.c_str(), default_encoding.c_str());
-		encoding = default_encoding;
-	}
+// the adjacency encoding takes O(n^2 * 2^state_bits) time, so it is not
+// used for FSMs with more states than this
+#define ADJACENCY_MAX_STATES 256
 
-	if (encoding == "none") {
-		log("  nothing to do for encoding `none'.\n");
-		return;
+// assign binary codes so that states with many transitions between them
+// get codes with a small hamming distance. the states are assigned in the
+// order of the number of transitions to already assigned states, each state
+// gets the free code with the smallest weighted distance to its neighbours.
+static std::vector<int> adjacency_codes(const FsmData &fsm_data, int state_bits)
+{
+	int num_states = fsm_data.state_table.size();
+	std::vector<std::vector<int>> weight(num_states, std::vector<int>(num_states));
+	for (auto &tr : fsm_data.transition_table)
+		if (tr.state_in >= 0 && tr.state_out >= 0 && tr.state_in != tr.state_out) {
+			weight[tr.state_in][tr.state_out]++;
+			weight[tr.state_out][tr.state_in]++;
+		}
+
+	std::vector<int> codes(num_states, -1);
+	std::vector<bool> code_used(1 << state_bits);
+
+	int first_state = fsm_data.reset_state >= 0 ? fsm_data.reset_state : 0;
+	codes[first_state] = 0;
+	code_used[0] = true;
+
+	for (int k = 1; k < num_states; k++)
+	{
+		int best_state = -1, best_weight = -1;
+		for (int i = 0; i < num_states; i++) {
+			if (codes[i] >= 0)
+				continue;
+			int w = 0;
+			for (int j = 0; j < num_states; j++)
+				if (codes[j] >= 0)
+					w += weight[i][j];
+			if (w > best_weight)
+				best_state = i, best_weight = w;
+		}
+
+		int best_code = -1, best_dist = 0;
+		for (int code = 0; code < (1 << state_bits); code++) {
+			if (code_used[code])
+				continue;
+			int dist = 0;
+			for (int j = 0; j < num_states; j++)
+				if (codes[j] >= 0)
+					dist += weight[best_state][j] * popcount(code ^ codes[j]);
+			if (best_code < 0 || dist < best_dist)
+				best_code = code, best_dist = dist;
+		}
+
+		codes[best_state] = best_code;
+		code_used[best_code] = true;
 	}
 
-	FsmData fsm_data;
-	fsm_data.copy_from_cell(cell);
+	return codes;
+}
 
-	if (fm_set_fsm_file != NULL)
-		fm_set_fsm_print(cell, module, fsm_data, "r", fm_set_fsm_file);
+static bool is_known_encoding(std::string encoding)
+{
+	return encoding == "one-hot" || encoding == "binary" || encoding == "gray" || encoding == "johnson" || encoding == "adjacency";
+}
+
+// set fsm_data.state_bits and fsm_data.state_table for the encoding
+static void encode_states(FsmData &fsm_data, std::string encoding)
+{
+	int num_states = fsm_data.state_table.size();
+
+	if (encoding == "adjacency" && num_states > ADJACENCY_MAX_STATES) {
+		log("  more than %d states: using binary instead of adjacency encoding.\n", ADJACENCY_MAX_STATES);
+		encoding = "binary";
+	}
 
 	if (encoding == "one-hot") {
-		fsm_data.state_bits = fsm_data.state_table.size();
+		fsm_data.state_bits = num_states;
 	} else
-	if (encoding == "auto" || encoding == "binary") {
-		fsm_data.state_bits = ceil(log2(fsm_data.state_table.size()));
+	if (encoding == "binary" || encoding == "gray" || encoding == "adjacency") {
+		fsm_data.state_bits = ceil(log2(num_states));
+	} else
+	if (encoding == "johnson") {
+		fsm_data.state_bits = std::max((num_states + 1) / 2, 1);
 	} else
 		log_error("FSM encoding `%s' is not supported!\n", encoding.c_str());
-	
+
+	std::vector<int> codes;
+	if (encoding == "adjacency")
+		codes = adjacency_codes(fsm_data, fsm_data.state_bits);
+
 	int state_idx_counter = fsm_data.reset_state >= 0 ? 1 : 0;
-	for (int i = 0; i < int(fsm_data.state_table.size()); i++)
+	for (int i = 0; i < num_states; i++)
 	{
 		int state_idx = fsm_data.reset_state == i ? 0 : state_idx_counter++;
 		RTLIL::Const new_code;
@@ -88,14 +156,205 @@ static void fsm_recode(RTLIL::Cell *cell, RTLIL::Module *module, FILE *fm_set_fs
 			new_code = RTLIL::Const(RTLIL::State::Sa, fsm_data.state_bits);
 			new_code.bits[state_idx] = RTLIL::State::S1;
 		} else
-		if (encoding == "auto" || encoding == "binary") {
+		if (encoding == "binary") {
 			new_code = RTLIL::Const(state_idx, fsm_data.state_bits);
+		} else
+		if (encoding == "gray") {
+			new_code = RTLIL::Const(state_idx ^ (state_idx >> 1), fsm_data.state_bits);
+		} else
+		if (encoding == "johnson") {
+			// 000, 001, 011, 111, 110, 100, ...
+			int n = fsm_data.state_bits;
+			new_code = RTLIL::Const(RTLIL::State::S0, n);
+			for (int j = state_idx <= n ? 0 : state_idx - n; j < std::min(state_idx, n); j++)
+				new_code.bits[j] = RTLIL::State::S1;
+		} else
+		if (encoding == "adjacency") {
+			new_code = RTLIL::Const(codes[i], fsm_data.state_bits);
 		} else
 			log_abort();
 
-		log("  %s -> %s\n", fsm_data.state_table[i].as_string().c_str(), new_code.as_string().c_str());
 		fsm_data.state_table[i] = new_code;
 	}
+}
+
+// estimate the size and depth of the logic generated by fsm_map for the
+// state encoding. the next state and output functions of the onehot state
+// signals are the same for all encodings, so only the parts that depend on
+// the encoding are counted (in two-input gates): the state register with
+// ff_cost gates per flip-flop, the decoder from the state register to the
+// onehot signals (assuming that later optimizations share common prefixes of
+// the decoder terms) and the $pmux that encodes the next state. the number
+// of state bits that change in the transitions is used to break ties between
+// encodings of the same size and depth.
+struct encoding_cost_t {
+	int gates, depth, toggles;
+	bool operator<(const encoding_cost_t &other) const {
+		if (gates != other.gates)
+			return gates < other.gates;
+		if (depth != other.depth)
+			return depth < other.depth;
+		return toggles < other.toggles;
+	}
+};
+
+static encoding_cost_t estimate_cost(const FsmData &fsm_data, int ff_cost)
+{
+	int num_states = fsm_data.state_table.size();
+	bool encoding_is_onehot = true;
+	int decode_depth = 0, encode_depth = 0;
+	std::set<RTLIL::Const> decoder_terms;
+
+	encoding_cost_t cost;
+	cost.gates = ff_cost * fsm_data.state_bits;
+
+	for (auto &code : fsm_data.state_table) {
+		int care_bits = 0, one_bits = 0;
+		RTLIL::Const prefix;
+		for (auto bit : code.bits) {
+			if (bit != RTLIL::State::S0 && bit != RTLIL::State::S1) {
+				prefix.bits.push_back(RTLIL::State::Sa);
+				continue;
+			}
+			prefix.bits.push_back(bit);
+			if (++care_bits > 1)
+				decoder_terms.insert(prefix);
+			if (bit == RTLIL::State::S1)
+				one_bits++;
+		}
+		if (care_bits == 1 && one_bits == 1)
+			continue;
+		encoding_is_onehot = false;
+		if (care_bits > 1)
+			decode_depth = std::max(decode_depth, int(ceil(log2(care_bits))));
+	}
+
+	// the $pmux has the reset state as A input and the other states as B
+	// inputs. each next state bit is the OR of the select signals of the
+	// states with this bit set, the bits that are set in the reset state
+	// also need the inverted OR of all select signals.
+	if (!encoding_is_onehot) {
+		cost.gates += decoder_terms.size();
+		bool reset_has_ones = false;
+		for (int j = 0; j < fsm_data.state_bits; j++) {
+			int one_states = 0;
+			for (int i = 0; i < num_states; i++)
+				if (i != fsm_data.reset_state && fsm_data.state_table[i].bits[j] == RTLIL::State::S1)
+					one_states++;
+			int depth = one_states > 1 ? int(ceil(log2(one_states))) : 0;
+			cost.gates += std::max(one_states - 1, 0);
+			if (fsm_data.reset_state >= 0 && fsm_data.state_table[fsm_data.reset_state].bits[j] == RTLIL::State::S1) {
+				reset_has_ones = true;
+				depth = std::max(depth, num_states > 2 ? int(ceil(log2(num_states - 1))) : 0) + 1;
+				cost.gates++;
+			}
+			encode_depth = std::max(encode_depth, depth);
+		}
+		if (reset_has_ones)
+			cost.gates += std::max(num_states - 2, 0);
+	}
+
+	std::set<std::pair<int, int>> edges;
+	for (auto &tr : fsm_data.transition_table)
+		if (tr.state_in >= 0 && tr.state_out >= 0 && tr.state_in != tr.state_out)
+			edges.insert(std::pair<int, int>(tr.state_in, tr.state_out));
+
+	cost.toggles = 0;
+	for (auto &edge : edges) {
+		const RTLIL::Const &code_in = fsm_data.state_table[edge.first];
+		const RTLIL::Const &code_out = fsm_data.state_table[edge.second];
+		for (int j = 0; j < fsm_data.state_bits; j++)
+			if ((code_in.bits[j] == RTLIL::State::S1) != (code_out.bits[j] == RTLIL::State::S1))
+				cost.toggles++;
+	}
+
+	cost.depth = decode_depth + encode_depth;
+	return cost;
+}
+
+struct search_result_t {
+	std::string encoding, report;
+};
+
+// try all encodings and return the one with the smallest estimated cost
+static void search_encoding(const FsmData &fsm_data, int ff_cost, search_result_t &result)
+{
+	std::string best_encoding;
+	encoding_cost_t best_cost = { 0, 0, 0 };
+
+	if (fsm_data.state_table.size() <= 1) {
+		result.report = "  FSM has less than two states: nothing to search.\n";
+		result.encoding = "one-hot";
+		return;
+	}
+
+	for (auto encoding : { "one-hot", "binary", "gray", "johnson", "adjacency" })
+	{
+		if (encoding == std::string("adjacency") && fsm_data.state_table.size() > ADJACENCY_MAX_STATES)
+			continue;
+
+		FsmData candidate = fsm_data;
+		encode_states(candidate, encoding);
+
+		encoding_cost_t cost = estimate_cost(candidate, ff_cost);
+		result.report += stringf("  encoding `%s': %d state bits, estimated %d gates, depth %d, %d toggles\n",
+				encoding, candidate.state_bits, cost.gates, cost.depth, cost.toggles);
+
+		if (best_encoding.empty() || cost < best_cost)
+			best_encoding = encoding, best_cost = cost;
+	}
+
+	result.encoding = best_encoding;
+}
+
+static std::string get_encoding_attr(RTLIL::Cell *cell)
+{
+	return cell->attributes.count("\\fsm_encoding") ? cell->attributes.at("\\fsm_encoding").decode_string() : "auto";
+}
+
+// resolve the encoding for an FSM cell from its `fsm_encoding' attribute and
+// the default encoding (used by the search pre-pass and by fsm_recode())
+static std::string get_encoding(RTLIL::Cell *cell, std::string default_encoding, bool verbose = false)
+{
+	std::string encoding = get_encoding_attr(cell);
+	if (encoding != "none" && encoding != "search" && !is_known_encoding(encoding)) {
+		if (verbose && encoding != "auto")
+			log("  unkown encoding `%s': using auto (%s) instead.\n", encoding.c_str(), default_encoding.c_str());
+		encoding = default_encoding;
+	}
+	if (encoding == "auto")
+		encoding = "binary";
+	return encoding;
+}
+
+static void fsm_recode(RTLIL::Cell *cell, RTLIL::Module *module, FILE *fm_set_fsm_file, std::string default_encoding, std::map<RTLIL::Cell*, search_result_t> &search_results)
+{
+	log("Recoding FSM `%s' from module `%s' using `%s' encoding:\n", cell->name.c_str(), module->name.c_str(), get_encoding_attr(cell).c_str());
+	std::string encoding = get_encoding(cell, default_encoding, true);
+
+	if (encoding == "none") {
+		log("  nothing to do for encoding `none'.\n");
+		return;
+	}
+
+	if (encoding == "search") {
+		search_result_t &result = search_results.at(cell);
+		log("%s", result.report.c_str());
+		log("  using encoding `%s'.\n", result.encoding.c_str());
+		encoding = result.encoding;
+	}
+
+	FsmData fsm_data;
+	fsm_data.copy_from_cell(cell);
+
+	if (fm_set_fsm_file != NULL)
+		fm_set_fsm_print(cell, module, fsm_data, "r", fm_set_fsm_file);
+
+	std::vector<RTLIL::Const> old_state_table = fsm_data.state_table;
+	encode_states(fsm_data, encoding);
+
+	for (size_t i = 0; i < fsm_data.state_table.size(); i++)
+		log("  %s -> %s\n", old_state_table[i].as_string().c_str(), fsm_data.state_table[i].as_string().c_str());
 
 	if (fm_set_fsm_file != NULL)
 		fm_set_fsm_print(cell, module, fsm_data, "i", fm_set_fsm_file);
@@ -109,12 +368,32 @@ struct FsmRecodePass : public Pass {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    fsm_recode [-encoding type] [-fm_set_fsm_file file] [selection]\n");
+		log("    fsm_recode [-encoding type] [-fm_set_fsm_file file] [-j num_threads]\n");
+		log("               [-ff_cost num_gates] [selection]\n");
+		log("\n");
+		log("This pass reassign the state encodings for FSM cells. The following encodings\n");
+		log("are supported:\n");
 		log("\n");
-		log("This pass reassign the state encodings for FSM cells. At the moment only\n");
-		log("one-hot encoding and binary encoding is supported. The option -encoding\n");
-		log("can be used to specify the encoding scheme used for FSMs without the\n");
-		log("`fsm_encoding' attribute (or with the attribute set to `auto'.\n");
+		log("    one-hot     one state bit per state\n");
+		log("    binary      states are numbered in binary (reset state is 0)\n");
+		log("    gray        states are numbered in gray code (reset state is 0)\n");
+		log("    johnson     johnson counter codes with ceil(n/2) state bits\n");
+		log("    adjacency   binary codes with a small hamming distance between states\n");
+		log("                that have many transitions between them (binary is used\n");
+		log("                instead for FSMs with more than %d states)\n", ADJACENCY_MAX_STATES);
+		log("    search      try all of the above and use the one with the smallest\n");
+		log("                estimated cost (size and depth of the logic created by\n");
+		log("                fsm_map)\n");
+		log("\n");
+		log("The option -ff_cost sets the cost of a flip-flop relative to a two-input gate\n");
+		log("for the `search' encoding (default: 4). Small values favour one-hot encoding,\n");
+		log("large values favour encodings with fewer state bits.\n");
+		log("\n");
+		log("The option -encoding can be used to specify the encoding scheme used for FSMs\n");
+		log("without the `fsm_encoding' attribute (or with the attribute set to `auto').\n");
+		log("\n");
+		log("The option -j can be used to run the encoding search for multiple FSMs in\n");
+		log("parallel using the specified number of threads.\n");
 		log("\n");
 		log("The option -fm_set_fsm_file can be used to generate a file containing the\n");
 		log("mapping from old to new FSM encoding in form of Synopsys Formality set_fsm_*\n");
@@ -125,6 +404,7 @@ struct FsmRecodePass : public Pass {
 	{
 		FILE *fm_set_fsm_file = NULL;
 		std::string default_encoding = "one-hot";
+		int num_threads = 1, ff_cost = 4;
 
 		log_header("Executing FSM_RECODE pass (re-assigning FSM state encoding).\n");
 		size_t argidx;
@@ -140,15 +420,60 @@ struct FsmRecodePass : public Pass {
 				default_encoding = args[++argidx];
 				continue;
 			}
+			if (arg == "-ff_cost" && argidx+1 < args.size()) {
+				ff_cost = atoi(args[++argidx].c_str());
+				if (ff_cost < 0)
+					cmd_error(args, argidx, "Flip-flop cost must not be negative.");
+				continue;
+			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_threads = atoi(args[++argidx].c_str());
+				if (num_threads < 1)
+					cmd_error(args, argidx, "Number of threads must be positive.");
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
+		std::vector<std::pair<RTLIL::Cell*, RTLIL::Module*>> fsm_cells;
 		for (auto &mod_it : design->modules)
 			if (design->selected(mod_it.second))
 				for (auto &cell_it : mod_it.second->cells)
 					if (cell_it.second->type == "$fsm" && design->selected(mod_it.second, cell_it.second))
-						fsm_recode(cell_it.second, mod_it.second, fm_set_fsm_file, default_encoding);
+						fsm_cells.push_back(std::pair<RTLIL::Cell*, RTLIL::Module*>(cell_it.second, mod_it.second));
+
+		// the encoding search only works on copies of the FSM data, so it
+		// can be done for all FSMs in parallel before the cells are modified
+		std::vector<FsmData> search_data;
+		std::vector<RTLIL::Cell*> search_cells;
+		for (auto &it : fsm_cells)
+			if (get_encoding(it.first, default_encoding) == "search") {
+				search_data.push_back(FsmData());
+				search_data.back().copy_from_cell(it.first);
+				search_cells.push_back(it.first);
+			}
+
+		std::vector<search_result_t> results(search_data.size());
+		std::atomic<size_t> next_job(0);
+		auto worker = [&]() {
+			for (size_t idx = next_job++; idx < search_data.size(); idx = next_job++)
+				search_encoding(search_data[idx], ff_cost, results[idx]);
+		};
+
+		std::vector<std::thread> workers;
+		for (int i = 1; i < num_threads && i < int(search_data.size()); i++)
+			workers.push_back(std::thread(worker));
+		worker();
+		for (auto &w : workers)
+			w.join();
+
+		std::map<RTLIL::Cell*, search_result_t> search_results;
+		for (size_t i = 0; i < search_cells.size(); i++)
+			search_results[search_cells[i]] = results[i];
+
+		for (auto &it : fsm_cells)
+			fsm_recode(it.first, it.second, fm_set_fsm_file, default_encoding, search_results);
 
 		if (fm_set_fsm_file != NULL)
 			fclose(fm_set_fsm_file);
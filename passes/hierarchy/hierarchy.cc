@@ -19,6 +19,7 @@
 
 #include "kernel/register.h"
 #include "kernel/log.h"
+#include "frontends/ast/ast.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <fnmatch.h>
@@ -31,6 +32,13 @@ namespace {
 		std::string portname;
 		int index;
 	};
+
+	// sets AST::derive_cache_dir for the duration of a hierarchy command
+	struct derive_cache_guard_t {
+		std::string backup_dir;
+		derive_cache_guard_t() : backup_dir(AST::derive_cache_dir) { }
+		~derive_cache_guard_t() { AST::derive_cache_dir = backup_dir; }
+	};
 }
 
 static void generate(RTLIL::Design *design, const std::vector<std::string> &celltypes, const std::vector<generate_port_decl_t> &portdecls)
@@ -247,7 +255,7 @@ struct HierarchyPass : public Pass {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    hierarchy [-check] [-top <module>]\n");
+		log("    hierarchy [-check] [-top <module>] [-derive_cache <dir>]\n");
 		log("    hierarchy -generate <cell-types> <port-decls>\n");
 		log("\n");
 		log("In parametric designs, a module might exists in serveral variations with\n");
@@ -280,6 +288,11 @@ struct HierarchyPass : public Pass {
 		log("        specified top module. otherwise a module with the 'top' attribute set\n");
 		log("        will implicitly be used as top module, if such a module exists.\n");
 		log("\n");
+		log("    -derive_cache <directory>\n");
+		log("        store the RTLIL representation of derived parametric modules in the\n");
+		log("        specified directory and re-use them in later runs when the module\n");
+		log("        source, the frontend options and the parameters are unchanged.\n");
+		log("\n");
 		log("In -generate mode this pass generates blackbox modules for the given cell\n");
 		log("types (wildcards supported). For this the design is searched for cells that\n");
 		log("match the given types and then the given port declarations are used to\n");
@@ -304,17 +317,19 @@ struct HierarchyPass : public Pass {
 		bool flag_check = false;
 		bool purge_lib = false;
 		RTLIL::Module *top_mod = NULL;
+		std::string top_name;
 		std::vector<std::string> libdirs;
 
 		bool generate_mode = false;
 		bool keep_positionals = false;
 		std::vector<std::string> generate_cells;
 		std::vector<generate_port_decl_t> generate_ports;
+		derive_cache_guard_t derive_cache_guard;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
 		{
-			if (args[argidx] == "-generate" && !flag_check && !top_mod) {
+			if (args[argidx] == "-generate" && !flag_check && top_name.empty()) {
 				generate_mode = true;
 				log("Entering generate mode.\n");
 				while (++argidx < args.size()) {
@@ -369,23 +384,34 @@ struct HierarchyPass : public Pass {
 				libdirs.push_back(args[++argidx]);
 				continue;
 			}
+			if (args[argidx] == "-derive_cache" && argidx+1 < args.size()) {
+				AST::derive_cache_dir = args[++argidx];
+				if (access(AST::derive_cache_dir.c_str(), W_OK) != 0)
+					log_cmd_error("Can't access derive cache directory `%s'!\n", AST::derive_cache_dir.c_str());
+				continue;
+			}
 			if (args[argidx] == "-top") {
 				if (++argidx >= args.size())
 					log_cmd_error("Option -top requires an additional argument!\n");
-				top_mod = design->modules.count(RTLIL::escape_id(args[argidx])) ? design->modules.at(RTLIL::escape_id(args[argidx])) : NULL;
-				if (top_mod == NULL && design->modules.count("$abstract" + RTLIL::escape_id(args[argidx]))) {
-					std::map<RTLIL::IdString, RTLIL::Const> empty_parameters;
-					design->modules.at("$abstract" + RTLIL::escape_id(args[argidx]))->derive(design, empty_parameters);
-					top_mod = design->modules.count(RTLIL::escape_id(args[argidx])) ? design->modules.at(RTLIL::escape_id(args[argidx])) : NULL;
-				}
-				if (top_mod == NULL)
-					log_cmd_error("Module `%s' not found!\n", args[argidx].c_str());
+				top_name = args[argidx];
 				continue;
 			}
 			break;
 		}
 		extra_args(args, argidx, design, false);
 
+		// resolve the top module after all options are parsed, so -derive_cache also applies here
+		if (!top_name.empty()) {
+			top_mod = design->modules.count(RTLIL::escape_id(top_name)) ? design->modules.at(RTLIL::escape_id(top_name)) : NULL;
+			if (top_mod == NULL && design->modules.count("$abstract" + RTLIL::escape_id(top_name))) {
+				std::map<RTLIL::IdString, RTLIL::Const> empty_parameters;
+				design->modules.at("$abstract" + RTLIL::escape_id(top_name))->derive(design, empty_parameters);
+				top_mod = design->modules.count(RTLIL::escape_id(top_name)) ? design->modules.at(RTLIL::escape_id(top_name)) : NULL;
+			}
+			if (top_mod == NULL)
+				log_cmd_error("Module `%s' not found!\n", top_name.c_str());
+		}
+
 		if (generate_mode) {
 			generate(design, generate_cells, generate_ports);
 			return;
@@ -0,0 +1,495 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+struct BramRule
+{
+	std::string name;
+	int abits, dbits, wrports, rdports;
+	int cost, minbits;
+	bool rdsync, transp, clkpol;
+	int linenum;
+
+	BramRule() : abits(0), dbits(0), wrports(1), rdports(1), cost(1), minbits(0),
+			rdsync(true), transp(false), clkpol(true), linenum(0) { }
+};
+
+static void parse_rules(FILE *f, std::string filename, std::vector<BramRule> &rules)
+{
+	char buffer[4096];
+	BramRule *rule = NULL;
+	int linenum = 0;
+
+	while (fgets(buffer, sizeof(buffer), f) != NULL)
+	{
+		linenum++;
+
+		char *p = strchr(buffer, '#');
+		if (p != NULL)
+			*p = 0;
+
+		std::istringstream line(buffer);
+		std::vector<std::string> tokens;
+		for (std::string tok; line >> tok;)
+			tokens.push_back(tok);
+
+		if (tokens.empty())
+			continue;
+
+		if (rule == NULL) {
+			if (tokens[0] != "bram" || tokens.size() != 2)
+				log_error("%s:%d: Expected `bram <celltype>'.\n", filename.c_str(), linenum);
+			rules.push_back(BramRule());
+			rule = &rules.back();
+			rule->name = RTLIL::escape_id(tokens[1]);
+			rule->linenum = linenum;
+			continue;
+		}
+
+		if (tokens[0] == "endbram" && tokens.size() == 1) {
+			if (rule->abits <= 0 || rule->dbits <= 0)
+				log_error("%s:%d: Missing abits or dbits for bram `%s'.\n", filename.c_str(), rule->linenum, RTLIL::id2cstr(rule->name));
+			if (rule->wrports <= 0 || rule->rdports <= 0)
+				log_error("%s:%d: Bram `%s' needs at least one read and one write port.\n", filename.c_str(), rule->linenum, RTLIL::id2cstr(rule->name));
+			rule = NULL;
+			continue;
+		}
+
+		if (tokens.size() != 2)
+			log_error("%s:%d: Syntax error in bram description.\n", filename.c_str(), linenum);
+
+		char *endptr;
+		int value = strtol(tokens[1].c_str(), &endptr, 0);
+		if (*endptr != 0 || value < 0)
+			log_error("%s:%d: Invalid value `%s'.\n", filename.c_str(), linenum, tokens[1].c_str());
+
+		if (tokens[0] == "abits")
+			rule->abits = value;
+		else if (tokens[0] == "dbits")
+			rule->dbits = value;
+		else if (tokens[0] == "wrports")
+			rule->wrports = value;
+		else if (tokens[0] == "rdports")
+			rule->rdports = value;
+		else if (tokens[0] == "rdsync")
+			rule->rdsync = value != 0;
+		else if (tokens[0] == "transp")
+			rule->transp = value != 0;
+		else if (tokens[0] == "clkpol")
+			rule->clkpol = value != 0;
+		else if (tokens[0] == "cost")
+			rule->cost = value;
+		else if (tokens[0] == "minbits")
+			rule->minbits = value;
+		else
+			log_error("%s:%d: Unknown bram property `%s'.\n", filename.c_str(), linenum, tokens[0].c_str());
+
+		if (rule->abits > 24)
+			log_error("%s:%d: Address width of bram `%s' is too large.\n", filename.c_str(), linenum, RTLIL::id2cstr(rule->name));
+	}
+
+	if (rule != NULL)
+		log_error("%s: Missing `endbram' for bram `%s'.\n", filename.c_str(), RTLIL::id2cstr(rule->name));
+}
+
+struct MemoryBramWorker
+{
+	RTLIL::Module *module;
+	RTLIL::Cell *cell;
+
+	int mem_size, mem_width, mem_abits;
+	int wr_ports, rd_ports;
+
+	std::vector<int> wr_active;
+	RTLIL::Const wr_clk_enable, wr_clk_polarity;
+	RTLIL::Const rd_clk_enable, rd_clk_polarity, rd_transparent;
+
+	std::string genid(std::string token, int i = -1, int j = -1, int k = -1)
+	{
+		std::stringstream sstr;
+		sstr << "$memory_bram" << cell->name << token;
+		if (i >= 0)
+			sstr << "[" << i << "]";
+		if (j >= 0)
+			sstr << "[" << j << "]";
+		if (k >= 0)
+			sstr << "[" << k << "]";
+		sstr << "$" << (RTLIL::autoidx++);
+		return sstr.str();
+	}
+
+	RTLIL::SigSpec add_wire(std::string name, int width)
+	{
+		RTLIL::Wire *w = new RTLIL::Wire;
+		w->name = name;
+		w->width = width;
+		module->wires[w->name] = w;
+		return RTLIL::SigSpec(w);
+	}
+
+	RTLIL::SigSpec add_binop(std::string type, std::string name, RTLIL::SigSpec sig_a, RTLIL::SigSpec sig_b)
+	{
+		RTLIL::Cell *c = new RTLIL::Cell;
+		c->name = name;
+		c->type = type;
+		c->parameters["\\A_SIGNED"] = RTLIL::Const(0);
+		c->parameters["\\B_SIGNED"] = RTLIL::Const(0);
+		c->parameters["\\A_WIDTH"] = RTLIL::Const(sig_a.width);
+		c->parameters["\\B_WIDTH"] = RTLIL::Const(sig_b.width);
+		c->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+		c->connections["\\A"] = sig_a;
+		c->connections["\\B"] = sig_b;
+		c->connections["\\Y"] = add_wire(name + "$y", 1);
+		module->cells[c->name] = c;
+		return c->connections["\\Y"];
+	}
+
+	RTLIL::SigSpec add_dff(std::string name, RTLIL::SigSpec sig_clk, bool clk_polarity, RTLIL::SigSpec sig_d)
+	{
+		RTLIL::Cell *c = new RTLIL::Cell;
+		c->name = name;
+		c->type = "$dff";
+		c->parameters["\\WIDTH"] = RTLIL::Const(sig_d.width);
+		c->parameters["\\CLK_POLARITY"] = RTLIL::Const(clk_polarity);
+		c->connections["\\CLK"] = sig_clk;
+		c->connections["\\D"] = sig_d;
+		c->connections["\\Q"] = add_wire(name + "$q", sig_d.width);
+		module->cells[c->name] = c;
+		return c->connections["\\Q"];
+	}
+
+	MemoryBramWorker(RTLIL::Module *module, RTLIL::Cell *cell) : module(module), cell(cell)
+	{
+		mem_size = cell->parameters["\\SIZE"].as_int();
+		mem_width = cell->parameters["\\WIDTH"].as_int();
+		mem_abits = cell->parameters["\\ABITS"].as_int();
+		wr_ports = cell->parameters["\\WR_PORTS"].as_int();
+		rd_ports = cell->parameters["\\RD_PORTS"].as_int();
+
+		wr_clk_enable = cell->parameters["\\WR_CLK_ENABLE"];
+		wr_clk_polarity = cell->parameters["\\WR_CLK_POLARITY"];
+		rd_clk_enable = cell->parameters["\\RD_CLK_ENABLE"];
+		rd_clk_polarity = cell->parameters["\\RD_CLK_POLARITY"];
+		rd_transparent = cell->parameters["\\RD_TRANSPARENT"];
+
+		// statically disabled write ports are simply dropped
+		for (int i = 0; i < wr_ports; i++) {
+			RTLIL::SigSpec wr_en = cell->connections["\\WR_EN"].extract(i, 1);
+			if (!wr_en.is_fully_const() || wr_en.as_int() != 0)
+				wr_active.push_back(i);
+		}
+	}
+
+	// returns the number of bram instances needed or 0 if the rule does not match
+	int check_rule(const BramRule &rule)
+	{
+		if (mem_size * mem_width < rule.minbits) {
+			log("    %s: memory is smaller than %d bits.\n", RTLIL::id2cstr(rule.name), rule.minbits);
+			return 0;
+		}
+
+		if (int(wr_active.size()) > rule.wrports) {
+			log("    %s: memory has %d write ports, bram only %d.\n", RTLIL::id2cstr(rule.name), int(wr_active.size()), rule.wrports);
+			return 0;
+		}
+
+		for (int i : wr_active)
+			if (wr_clk_enable.bits[i] != RTLIL::State::S1 || (wr_clk_polarity.bits[i] == RTLIL::State::S1) != rule.clkpol) {
+				log("    %s: write port %d has an incompatible clock.\n", RTLIL::id2cstr(rule.name), i);
+				return 0;
+			}
+
+		for (int i = 0; i < rd_ports; i++) {
+			if ((rd_clk_enable.bits[i] == RTLIL::State::S1) != rule.rdsync) {
+				log("    %s: read port %d is %s.\n", RTLIL::id2cstr(rule.name), i, rule.rdsync ? "asynchronous" : "synchronous");
+				return 0;
+			}
+			if (!rule.rdsync)
+				continue;
+			if ((rd_clk_polarity.bits[i] == RTLIL::State::S1) != rule.clkpol) {
+				log("    %s: read port %d has an incompatible clock.\n", RTLIL::id2cstr(rule.name), i);
+				return 0;
+			}
+			if (!wr_active.empty() && (rd_transparent.bits[i] == RTLIL::State::S1) != rule.transp) {
+				log("    %s: read port %d is %stransparent.\n", RTLIL::id2cstr(rule.name), i, rule.transp ? "not " : "");
+				return 0;
+			}
+		}
+
+		int depth_tiles = (mem_size + (1 << rule.abits) - 1) >> rule.abits;
+		int width_tiles = (mem_width + rule.dbits - 1) / rule.dbits;
+		int replicas = std::max((rd_ports + rule.rdports - 1) / rule.rdports, 1);
+
+		log("    %s: %d x %d tiles, %d replicas, cost %d.\n", RTLIL::id2cstr(rule.name),
+				depth_tiles, width_tiles, replicas, depth_tiles * width_tiles * replicas * rule.cost);
+		return depth_tiles * width_tiles * replicas;
+	}
+
+	void map(const BramRule &rule)
+	{
+		int depth_tiles = (mem_size + (1 << rule.abits) - 1) >> rule.abits;
+		int width_tiles = (mem_width + rule.dbits - 1) / rule.dbits;
+		int replicas = std::max((rd_ports + rule.rdports - 1) / rule.rdports, 1);
+		int lo_abits = std::min(rule.abits, mem_abits);
+		int hi_abits = mem_abits - lo_abits;
+
+		// write ports: the low address bits go to the bram, the high bits select the depth tile
+		std::vector<RTLIL::SigSpec> wr_addr, wr_clk;
+		std::vector<std::vector<RTLIL::SigSpec>> wr_en;
+		for (int i : wr_active)
+		{
+			RTLIL::SigSpec addr = cell->connections["\\WR_ADDR"].extract(i*mem_abits, mem_abits);
+			RTLIL::SigSpec en = cell->connections["\\WR_EN"].extract(i, 1);
+
+			wr_addr.push_back(addr.extract(0, lo_abits));
+			wr_addr.back().extend(rule.abits, false);
+			wr_clk.push_back(cell->connections["\\WR_CLK"].extract(i, 1));
+			wr_en.push_back(std::vector<RTLIL::SigSpec>());
+
+			for (int d = 0; d < depth_tiles; d++) {
+				if (depth_tiles == 1) {
+					wr_en.back().push_back(en);
+					continue;
+				}
+				RTLIL::SigSpec sel = add_binop("$eq", genid("$wrsel", i, d), addr.extract(lo_abits, hi_abits), RTLIL::SigSpec(d, hi_abits));
+				if (en.is_fully_const() && en.as_int() == 1)
+					wr_en.back().push_back(sel);
+				else
+					wr_en.back().push_back(add_binop("$and", genid("$wren", i, d), sel, en));
+			}
+		}
+
+		// rd_data[port][depth_tile] collects the bram outputs for each read port
+		std::vector<std::vector<RTLIL::SigSpec>> rd_data(rd_ports, std::vector<RTLIL::SigSpec>(depth_tiles));
+
+		for (int r = 0; r < replicas; r++)
+		for (int d = 0; d < depth_tiles; d++)
+		for (int w = 0; w < width_tiles; w++)
+		{
+			RTLIL::Cell *c = new RTLIL::Cell;
+			c->name = genid("$bram", r, d, w);
+			c->type = rule.name;
+			module->cells[c->name] = c;
+
+			int data_offset = w * rule.dbits;
+			int data_width = std::min(rule.dbits, mem_width - data_offset);
+
+			for (int k = 0; k < rule.wrports; k++)
+			{
+				std::string prefix = stringf("\\WR%d_", k+1);
+				if (k < int(wr_active.size())) {
+					RTLIL::SigSpec data = cell->connections["\\WR_DATA"].extract(wr_active[k]*mem_width + data_offset, data_width);
+					data.extend(rule.dbits, false);
+					c->connections[prefix + "CLK"] = wr_clk[k];
+					c->connections[prefix + "EN"] = wr_en[k][d];
+					c->connections[prefix + "ADDR"] = wr_addr[k];
+					c->connections[prefix + "DATA"] = data;
+				} else {
+					c->connections[prefix + "CLK"] = RTLIL::SigSpec(RTLIL::State::S0);
+					c->connections[prefix + "EN"] = RTLIL::SigSpec(RTLIL::State::S0);
+					c->connections[prefix + "ADDR"] = RTLIL::SigSpec(RTLIL::State::S0, rule.abits);
+					c->connections[prefix + "DATA"] = RTLIL::SigSpec(RTLIL::State::S0, rule.dbits);
+				}
+			}
+
+			for (int k = 0; k < rule.rdports; k++)
+			{
+				std::string prefix = stringf("\\RD%d_", k+1);
+				int i = r * rule.rdports + k;
+				RTLIL::SigSpec data = add_wire(genid("$rddata", r, d, w) + stringf("$%d", k+1), rule.dbits);
+				c->connections[prefix + "DATA"] = data;
+				if (i < rd_ports) {
+					RTLIL::SigSpec addr = cell->connections["\\RD_ADDR"].extract(i*mem_abits, lo_abits);
+					addr.extend(rule.abits, false);
+					if (rule.rdsync)
+						c->connections[prefix + "CLK"] = cell->connections["\\RD_CLK"].extract(i, 1);
+					c->connections[prefix + "ADDR"] = addr;
+					rd_data[i][d].append(data.extract(0, data_width));
+				} else {
+					if (rule.rdsync)
+						c->connections[prefix + "CLK"] = RTLIL::SigSpec(RTLIL::State::S0);
+					c->connections[prefix + "ADDR"] = RTLIL::SigSpec(RTLIL::State::S0, rule.abits);
+				}
+			}
+		}
+
+		// read ports: select the depth tile using the (registered) high address bits
+		for (int i = 0; i < rd_ports; i++)
+		{
+			RTLIL::SigSpec rd_sig = cell->connections["\\RD_DATA"].extract(i*mem_width, mem_width);
+
+			if (depth_tiles == 1) {
+				module->connections.push_back(RTLIL::SigSig(rd_sig, rd_data[i][0]));
+				continue;
+			}
+
+			RTLIL::SigSpec sel_addr = cell->connections["\\RD_ADDR"].extract(i*mem_abits + lo_abits, hi_abits);
+			if (rule.rdsync)
+				sel_addr = add_dff(genid("$rdsel", i), cell->connections["\\RD_CLK"].extract(i, 1),
+						rd_clk_polarity.bits[i] == RTLIL::State::S1, sel_addr);
+
+			RTLIL::Cell *c = new RTLIL::Cell;
+			c->name = genid("$rdmux", i);
+			c->type = "$pmux";
+			c->parameters["\\WIDTH"] = RTLIL::Const(mem_width);
+			c->parameters["\\S_WIDTH"] = RTLIL::Const(depth_tiles-1);
+			c->connections["\\A"] = rd_data[i][0];
+			c->connections["\\B"] = RTLIL::SigSpec();
+			c->connections["\\S"] = RTLIL::SigSpec();
+			for (int d = 1; d < depth_tiles; d++) {
+				c->connections["\\B"].append(rd_data[i][d]);
+				c->connections["\\S"].append(add_binop("$eq", genid("$rdsel", i, d), sel_addr, RTLIL::SigSpec(d, hi_abits)));
+			}
+			c->connections["\\Y"] = rd_sig;
+			module->cells[c->name] = c;
+		}
+
+		log("  Mapped to %d %s cells.\n", depth_tiles * width_tiles * replicas, RTLIL::id2cstr(rule.name));
+
+		module->cells.erase(cell->name);
+		delete cell;
+	}
+};
+
+static void handle_cell(RTLIL::Module *module, RTLIL::Cell *cell, const std::vector<BramRule> &rules)
+{
+	log("Processing memory cell `%s' in module `%s':\n", cell->name.c_str(), module->name.c_str());
+
+	MemoryBramWorker worker(module, cell);
+
+	if (worker.rd_ports == 0) {
+		log("  Memory has no read ports.\n");
+		return;
+	}
+
+	const BramRule *best_rule = NULL;
+	int best_cost = 0;
+
+	for (auto &rule : rules) {
+		int count = worker.check_rule(rule);
+		if (count > 0 && (best_rule == NULL || count * rule.cost < best_cost))
+			best_rule = &rule, best_cost = count * rule.cost;
+	}
+
+	if (best_rule == NULL) {
+		log("  No matching bram found, leaving memory unmapped.\n");
+		return;
+	}
+
+	worker.map(*best_rule);
+}
+
+struct MemoryBramPass : public Pass {
+	MemoryBramPass() : Pass("memory_bram", "map memories to block rams") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    memory_bram -rules <rule_file> [selection]\n");
+		log("\n");
+		log("This pass maps multiport memory cells as generated by the memory_collect pass\n");
+		log("to block ram cells described in a rules file. Memories are split into several\n");
+		log("block rams when they are wider or deeper than one block ram, and block rams\n");
+		log("are replicated when the memory has more read ports than the block ram. For\n");
+		log("each memory the matching block ram with the lowest total cost is used.\n");
+		log("Memories that do not match any block ram are left unchanged, so memory_map\n");
+		log("can be used to map them to logic afterwards.\n");
+		log("\n");
+		log("    -rules <rule_file>\n");
+		log("        read the block ram descriptions from this file\n");
+		log("\n");
+		log("    -share_rules <rule_file>\n");
+		log("        like -rules but look up the file in the yosys data files directory\n");
+		log("\n");
+		log("A rules file contains one or more block ram descriptions. Empty lines and\n");
+		log("everything after a '#' are ignored:\n");
+		log("\n");
+		log("    bram RAMB1024X16\n");
+		log("        abits 10      # number of address bits\n");
+		log("        dbits 16      # number of data bits\n");
+		log("        wrports 1     # number of write ports (default 1)\n");
+		log("        rdports 1     # number of read ports (default 1)\n");
+		log("        rdsync 1      # read ports are clocked (default 1)\n");
+		log("        transp 0      # clocked read ports are transparent (default 0)\n");
+		log("        clkpol 1      # clock polarity, 1 for posedge (default 1)\n");
+		log("        cost 1        # cost of one block ram (default 1)\n");
+		log("        minbits 0     # do not use for smaller memories (default 0)\n");
+		log("    endbram\n");
+		log("\n");
+		log("Block ram cells are created with the ports WR<n>_CLK, WR<n>_EN, WR<n>_ADDR and\n");
+		log("WR<n>_DATA for each write port and RD<n>_CLK (only if rdsync is set), RD<n>_ADDR\n");
+		log("and RD<n>_DATA for each read port. Unused ports are tied to zero. A techmap file\n");
+		log("is needed to map these cells to the actual vendor primitives.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		std::vector<std::string> rules_files;
+
+		log_header("Executing MEMORY_BRAM pass (mapping $mem cells to block rams).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-rules" && argidx+1 < args.size()) {
+				rules_files.push_back(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-share_rules" && argidx+1 < args.size()) {
+				rules_files.push_back(proc_share_dirname() + args[++argidx]);
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (rules_files.empty())
+			log_cmd_error("Missing -rules option.\n");
+
+		std::vector<BramRule> rules;
+		for (auto &fn : rules_files) {
+			FILE *f = fopen(fn.c_str(), "rt");
+			if (f == NULL)
+				log_cmd_error("Can't open rules file `%s'\n", fn.c_str());
+			parse_rules(f, fn, rules);
+			fclose(f);
+		}
+
+		for (auto &mod_it : design->modules)
+		{
+			if (!design->selected(mod_it.second))
+				continue;
+
+			std::vector<RTLIL::Cell*> cells;
+			for (auto &cell_it : mod_it.second->cells)
+				if (cell_it.second->type == "$mem" && design->selected(mod_it.second, cell_it.second))
+					cells.push_back(cell_it.second);
+
+			for (auto cell : cells)
+				handle_cell(mod_it.second, cell, rules);
+		}
+	}
+} MemoryBramPass;
@@ -46,6 +46,48 @@ static std::string genid(std::string name, std::string token1 = "", int i = -1,
 	return sstr.str();
 }
 
+static RTLIL::SigSpec add_eq(RTLIL::Module *module, std::string name, RTLIL::SigSpec sig_a, RTLIL::SigSpec sig_b)
+{
+	RTLIL::Cell *c = new RTLIL::Cell;
+	c->name = name;
+	c->type = "$eq";
+	c->parameters["\\A_SIGNED"] = RTLIL::Const(0);
+	c->parameters["\\B_SIGNED"] = RTLIL::Const(0);
+	c->parameters["\\A_WIDTH"] = RTLIL::Const(sig_a.width);
+	c->parameters["\\B_WIDTH"] = RTLIL::Const(sig_b.width);
+	c->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+	c->connections["\\A"] = sig_a;
+	c->connections["\\B"] = sig_b;
+	module->cells[c->name] = c;
+
+	RTLIL::Wire *w = new RTLIL::Wire;
+	w->name = name + "$y";
+	module->wires[w->name] = w;
+	c->connections["\\Y"] = RTLIL::SigSpec(w);
+	return c->connections["\\Y"];
+}
+
+static RTLIL::SigSpec add_and(RTLIL::Module *module, std::string name, RTLIL::SigSpec sig_a, RTLIL::SigSpec sig_b)
+{
+	RTLIL::Cell *c = new RTLIL::Cell;
+	c->name = name;
+	c->type = "$and";
+	c->parameters["\\A_SIGNED"] = RTLIL::Const(0);
+	c->parameters["\\B_SIGNED"] = RTLIL::Const(0);
+	c->parameters["\\A_WIDTH"] = RTLIL::Const(1);
+	c->parameters["\\B_WIDTH"] = RTLIL::Const(1);
+	c->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+	c->connections["\\A"] = sig_a;
+	c->connections["\\B"] = sig_b;
+	module->cells[c->name] = c;
+
+	RTLIL::Wire *w = new RTLIL::Wire;
+	w->name = name + "$y";
+	module->wires[w->name] = w;
+	c->connections["\\Y"] = RTLIL::SigSpec(w);
+	return c->connections["\\Y"];
+}
+
 static void handle_cell(RTLIL::Module *module, RTLIL::Cell *cell)
 {
 	std::set<int> static_ports;
@@ -151,6 +193,11 @@ static void handle_cell(RTLIL::Module *module, RTLIL::Cell *cell)
 
 	log("  created %d $dff cells and %d static cells of width %d.\n", mem_size-count_static, count_static, mem_width);
 
+	// number of address bits needed to address all words
+	int used_abits = 0;
+	while (used_abits < mem_abits && (1 << used_abits) < mem_size)
+		used_abits++;
+
 	int count_dff = 0, count_mux = 0, count_wrmux = 0;
 
 	for (int i = 0; i < cell->parameters["\\RD_PORTS"].as_int(); i++)
@@ -205,18 +252,33 @@ static void handle_cell(RTLIL::Module *module, RTLIL::Cell *cell)
 			}
 		}
 
-		for (int j = 0; j < mem_abits; j++)
+		// the mux tree only decodes the address bits that are needed to select
+		// one of the words, and sub-trees that only cover addresses beyond the
+		// end of the memory are left out (reading from them is undefined)
+		for (int j = 0; j < used_abits; j++)
 		{
 			std::vector<RTLIL::SigSpec> next_rd_signals;
 
 			for (size_t k = 0; k < rd_signals.size(); k++)
 			{
+				if (rd_signals[k].width == 0) {
+					next_rd_signals.push_back(RTLIL::SigSpec());
+					next_rd_signals.push_back(RTLIL::SigSpec());
+					continue;
+				}
+
+				if (((2*k+1) << (used_abits-j-1)) >= size_t(mem_size)) {
+					next_rd_signals.push_back(rd_signals[k]);
+					next_rd_signals.push_back(RTLIL::SigSpec());
+					continue;
+				}
+
 				RTLIL::Cell *c = new RTLIL::Cell;
 				c->name = genid(cell->name, "$rdmux", i, "", j, "", k);
 				c->type = "$mux";
 				c->parameters["\\WIDTH"] = cell->parameters["\\WIDTH"];
 				c->connections["\\Y"] = rd_signals[k];
-				c->connections["\\S"] = rd_addr.extract(mem_abits-j-1, 1);
+				c->connections["\\S"] = rd_addr.extract(used_abits-j-1, 1);
 				module->cells[c->name] = c;
 				count_mux++;
 
@@ -245,6 +307,53 @@ static void handle_cell(RTLIL::Module *module, RTLIL::Cell *cell)
 
 	log("  read interface: %d $dff and %d $mux cells.\n", count_dff, count_mux);
 
+	// the write enable of each word is generated by a shared two-level address
+	// decoder for each write port: the low and the high part of the address are
+	// decoded separately and each word enable is the AND of one output from each
+	// part. the write enable of the port is merged into the high part decoder.
+	int wr_ports = cell->parameters["\\WR_PORTS"].as_int();
+	int lo_abits = used_abits / 2;
+	std::vector<std::vector<RTLIL::SigSpec>> wr_word_en(wr_ports);
+	int count_wrdec = 0;
+
+	for (int j = 0; j < wr_ports; j++)
+	{
+		if (static_ports.count(j) > 0)
+			continue;
+
+		RTLIL::SigSpec wr_addr = cell->connections["\\WR_ADDR"].extract(j*mem_abits, mem_abits);
+		RTLIL::SigSpec wr_en = cell->connections["\\WR_EN"].extract(j, 1);
+
+		std::vector<RTLIL::SigSpec> lo_sel, hi_sel;
+
+		for (int k = 0; lo_abits > 0 && k < (1 << lo_abits) && k < mem_size; k++) {
+			RTLIL::SigSpec y = add_eq(module, genid(cell->name, "$wrdec_lo", j, "", k), RTLIL::SigSpec(k, lo_abits), wr_addr.extract(0, lo_abits));
+			lo_sel.push_back(y);
+			count_wrdec++;
+		}
+
+		for (int k = 0; (k << lo_abits) < mem_size; k++) {
+			RTLIL::SigSpec y = add_eq(module, genid(cell->name, "$wrdec_hi", j, "", k), RTLIL::SigSpec(k, mem_abits-lo_abits),
+					wr_addr.extract(lo_abits, mem_abits-lo_abits));
+			if (wr_en != RTLIL::SigSpec(1, 1))
+				y = add_and(module, genid(cell->name, "$wrdec_en", j, "", k), y, wr_en);
+			hi_sel.push_back(y);
+			count_wrdec++;
+		}
+
+		for (int i = 0; i < mem_size; i++) {
+			if (static_cells_map.count(i) > 0) {
+				wr_word_en[j].push_back(RTLIL::SigSpec());
+				continue;
+			}
+			if (lo_abits == 0)
+				wr_word_en[j].push_back(hi_sel.at(i));
+			else
+				wr_word_en[j].push_back(add_and(module, genid(cell->name, "$wren", i, "", j),
+						hi_sel.at(i >> lo_abits), lo_sel.at(i & ((1 << lo_abits)-1))));
+		}
+	}
+
 	for (int i = 0; i < mem_size; i++)
 	{
 		if (static_cells_map.count(i) > 0)
@@ -252,60 +361,24 @@ static void handle_cell(RTLIL::Module *module, RTLIL::Cell *cell)
 
 		RTLIL::SigSpec sig = data_reg_out[i];
 
-		for (int j = 0; j < cell->parameters["\\WR_PORTS"].as_int(); j++)
+		for (int j = 0; j < wr_ports; j++)
 		{
-			RTLIL::SigSpec wr_addr = cell->connections["\\WR_ADDR"].extract(j*mem_abits, mem_abits);
+			if (static_ports.count(j) > 0)
+				continue;
+
 			RTLIL::SigSpec wr_data = cell->connections["\\WR_DATA"].extract(j*mem_width, mem_width);
-			RTLIL::SigSpec wr_en = cell->connections["\\WR_EN"].extract(j, 1);
 
 			RTLIL::Cell *c = new RTLIL::Cell;
-			c->name = genid(cell->name, "$wreq", i, "", j);
-			c->type = "$eq";
-			c->parameters["\\A_SIGNED"] = RTLIL::Const(0);
-			c->parameters["\\B_SIGNED"] = RTLIL::Const(0);
-			c->parameters["\\A_WIDTH"] = cell->parameters["\\ABITS"];
-			c->parameters["\\B_WIDTH"] = cell->parameters["\\ABITS"];
-			c->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
-			c->connections["\\A"] = RTLIL::SigSpec(i, mem_abits);
-			c->connections["\\B"] = wr_addr;
-			module->cells[c->name] = c;
-			count_wrmux++;
-
-			RTLIL::Wire *w = new RTLIL::Wire;
-			w->name = genid(cell->name, "$wreq", i, "", j, "$y");
-			module->wires[w->name] = w;
-			c->connections["\\Y"] = RTLIL::SigSpec(w);
-
-			if (wr_en != RTLIL::SigSpec(1, 1))
-			{
-				c = new RTLIL::Cell;
-				c->name = genid(cell->name, "$wren", i, "", j);
-				c->type = "$and";
-				c->parameters["\\A_SIGNED"] = RTLIL::Const(0);
-				c->parameters["\\B_SIGNED"] = RTLIL::Const(0);
-				c->parameters["\\A_WIDTH"] = RTLIL::Const(1);
-				c->parameters["\\B_WIDTH"] = RTLIL::Const(1);
-				c->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
-				c->connections["\\A"] = RTLIL::SigSpec(w);
-				c->connections["\\B"] = wr_en;
-				module->cells[c->name] = c;
-
-				w = new RTLIL::Wire;
-				w->name = genid(cell->name, "$wren", i, "", j, "$y");
-				module->wires[w->name] = w;
-				c->connections["\\Y"] = RTLIL::SigSpec(w);
-			}
-
-			c = new RTLIL::Cell;
 			c->name = genid(cell->name, "$wrmux", i, "", j);
 			c->type = "$mux";
 			c->parameters["\\WIDTH"] = cell->parameters["\\WIDTH"];
 			c->connections["\\A"] = sig;
 			c->connections["\\B"] = wr_data;
-			c->connections["\\S"] = RTLIL::SigSpec(w);
+			c->connections["\\S"] = wr_word_en[j][i];
 			module->cells[c->name] = c;
+			count_wrmux++;
 
-			w = new RTLIL::Wire;
+			RTLIL::Wire *w = new RTLIL::Wire;
 			w->name = genid(cell->name, "$wrmux", i, "", j, "$y");
 			w->width = mem_width;
 			module->wires[w->name] = w;
@@ -316,7 +389,7 @@ static void handle_cell(RTLIL::Module *module, RTLIL::Cell *cell)
 		module->connections.push_back(RTLIL::SigSig(data_reg_in[i], sig));
 	}
 
-	log("  write interface: %d blocks of $eq, $and and $mux cells.\n", count_wrmux);
+	log("  write interface: %d decoder outputs and %d $mux cells.\n", count_wrdec, count_wrmux);
 
 	module->cells.erase(cell->name);
 	delete cell;
@@ -344,6 +417,10 @@ struct MemoryMapPass : public Pass {
 		log("This pass converts multiport memory cells as generated by the memory_collect\n");
 		log("pass to word-wide DFFs and address decoders.\n");
 		log("\n");
+		log("Each read port is mapped to a tree of $mux cells over the address bits that\n");
+		log("are needed to select a word. Each write port gets one shared address decoder\n");
+		log("that decodes the low and the high half of the address separately.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design) {
 		log_header("Executing MEMORY_MAP pass (converting $mem cells to logic and flip-flops).\n");
@@ -155,6 +155,9 @@ struct OptMuxtreeWorker
 
 		log("  Evaluating internal representation of mux trees.\n");
 
+		knowledge.known_inactive.resize(bit2info.size());
+		knowledge.visited_muxes.resize(mux2info.size());
+
 		std::set<int> root_muxes;
 		for (auto &bi : bit2info) {
 			if (!bi.seen_non_mux)
@@ -279,24 +282,39 @@ struct OptMuxtreeWorker
 	struct knowledge_t
 	{
 		// database of known inactive signals
-		// the 2nd integer is a reference counter used to manage the
-		// list. when it is non-zero the signal in known to be inactive
-		std::map<int, int> known_inactive;
+		// the value is a reference counter used to manage the list. when
+		// it is non-zero the signal in known to be inactive
+		std::vector<int> known_inactive;
 
 		// database of known active signals
-		// the 2nd dimension is the list of or-ed signals. so we know that
-		// for each i there is a j so that known_active[i][j] points to an
-		// inactive control signal.
-		std::vector<std::vector<int>> known_active;
+		// each entry is a list of or-ed signals. so we know that for each i
+		// there is a j so that (*known_active[i])[j] points to an active
+		// control signal.
+		std::vector<const std::vector<int>*> known_active;
 
 		// this is just used to keep track of visited muxes in order to prohibit
-		// endless recursion in mux loops
-		std::set<int> visited_muxes;
+		// endless loops in mux loops
+		std::vector<bool> visited_muxes;
 	};
 
-	void eval_mux_port(knowledge_t &knowledge, int mux_idx, int port_idx)
+	// the mux trees are evaluated using an explicit stack so that very deep
+	// mux trees do not overflow the call stack. there are two kinds of
+	// frames: a mux frame (port_idx < 0) iterates over the ports of a mux
+	// that can be active and a port frame iterates over the muxes driving
+	// the inputs of an active port.
+	struct eval_frame_t
 	{
-		muxinfo_t &muxinfo = mux2info[mux_idx];
+		int mux_idx, port_idx;
+		std::vector<int> items;
+		size_t next_item;
+	};
+
+	knowledge_t knowledge;
+
+	void enter_mux_port(eval_frame_t &frame)
+	{
+		muxinfo_t &muxinfo = mux2info[frame.mux_idx];
+		int port_idx = frame.port_idx;
 		muxinfo.ports[port_idx].enabled = true;
 
 		for (size_t i = 0; i < muxinfo.ports.size(); i++) {
@@ -307,19 +325,23 @@ struct OptMuxtreeWorker
 		}
 
 		if (port_idx < int(muxinfo.ports.size())-1 && !muxinfo.ports[port_idx].const_activated)
-			knowledge.known_active.push_back(muxinfo.ports[port_idx].ctrl_sigs);
+			knowledge.known_active.push_back(&muxinfo.ports[port_idx].ctrl_sigs);
 
-		std::vector<int> parent_muxes;
 		for (int m : muxinfo.ports[port_idx].input_muxes) {
-			if (knowledge.visited_muxes.count(m) > 0)
+			if (knowledge.visited_muxes[m])
 				continue;
-			knowledge.visited_muxes.insert(m);
-			parent_muxes.push_back(m);
+			knowledge.visited_muxes[m] = true;
+			frame.items.push_back(m);
 		}
-		for (int m : parent_muxes)
-			eval_mux(knowledge, m);
-		for (int m : parent_muxes)
-			knowledge.visited_muxes.erase(m);
+	}
+
+	void leave_mux_port(eval_frame_t &frame)
+	{
+		muxinfo_t &muxinfo = mux2info[frame.mux_idx];
+		int port_idx = frame.port_idx;
+
+		for (int m : frame.items)
+			knowledge.visited_muxes[m] = false;
 
 		if (port_idx < int(muxinfo.ports.size())-1 && !muxinfo.ports[port_idx].const_activated)
 			knowledge.known_active.pop_back();
@@ -332,16 +354,18 @@ struct OptMuxtreeWorker
 		}
 	}
 
-	void eval_mux(knowledge_t &knowledge, int mux_idx)
+	// the knowledge is the same before each port of a mux is evaluated, so the
+	// list of ports that can be active is created when the mux is entered
+	void enter_mux(eval_frame_t &frame)
 	{
-		muxinfo_t &muxinfo = mux2info[mux_idx];
+		muxinfo_t &muxinfo = mux2info[frame.mux_idx];
 
 		// if there is a constant activated port we just use it
 		for (size_t port_idx = 0; port_idx < muxinfo.ports.size()-1; port_idx++)
 		{
 			portinfo_t &portinfo = muxinfo.ports[port_idx];
 			if (portinfo.const_activated) {
-				eval_mux_port(knowledge, mux_idx, port_idx);
+				frame.items.push_back(port_idx);
 				return;
 			}
 		}
@@ -353,8 +377,8 @@ struct OptMuxtreeWorker
 		{
 			portinfo_t &portinfo = muxinfo.ports[port_idx];
 			for (size_t i = 0; i < knowledge.known_active.size(); i++) {
-				if (list_is_subset(knowledge.known_active[i], portinfo.ctrl_sigs)) {
-					eval_mux_port(knowledge, mux_idx, port_idx);
+				if (list_is_subset(*knowledge.known_active[i], portinfo.ctrl_sigs)) {
+					frame.items.push_back(port_idx);
 					return;
 				}
 			}
@@ -378,27 +402,66 @@ struct OptMuxtreeWorker
 			}
 
 			bool port_active = true;
-			std::vector<int> other_ctrl_sig;
-			for (size_t i = 0; i < muxinfo.ports.size()-1; i++) {
-				if (i == port_idx)
-					continue;
-				other_ctrl_sig.insert(other_ctrl_sig.end(),
-						muxinfo.ports[i].ctrl_sigs.begin(), muxinfo.ports[i].ctrl_sigs.end());
-			}
-			for (size_t i = 0; i < knowledge.known_active.size(); i++) {
-				if (list_is_subset(knowledge.known_active[i], other_ctrl_sig))
-					port_active = false;
+			if (!knowledge.known_active.empty()) {
+				std::vector<int> other_ctrl_sig;
+				for (size_t i = 0; i < muxinfo.ports.size()-1; i++) {
+					if (i == port_idx)
+						continue;
+					other_ctrl_sig.insert(other_ctrl_sig.end(),
+							muxinfo.ports[i].ctrl_sigs.begin(), muxinfo.ports[i].ctrl_sigs.end());
+				}
+				for (size_t i = 0; i < knowledge.known_active.size(); i++) {
+					if (list_is_subset(*knowledge.known_active[i], other_ctrl_sig))
+						port_active = false;
+				}
 			}
 			if (port_active)
-				eval_mux_port(knowledge, mux_idx, port_idx);
+				frame.items.push_back(port_idx);
 		}
 	}
 
 	void eval_root_mux(int mux_idx)
 	{
-		knowledge_t knowledge;
-		knowledge.visited_muxes.insert(mux_idx);
-		eval_mux(knowledge, mux_idx);
+		std::vector<eval_frame_t> stack;
+		knowledge.visited_muxes[mux_idx] = true;
+
+		stack.push_back(eval_frame_t());
+		stack.back().mux_idx = mux_idx;
+		stack.back().port_idx = -1;
+		stack.back().next_item = 0;
+		enter_mux(stack.back());
+
+		while (!stack.empty())
+		{
+			eval_frame_t &frame = stack.back();
+
+			if (frame.next_item == frame.items.size()) {
+				if (frame.port_idx >= 0)
+					leave_mux_port(frame);
+				stack.pop_back();
+				continue;
+			}
+
+			int item = frame.items[frame.next_item++];
+			int frame_mux_idx = frame.mux_idx, frame_port_idx = frame.port_idx;
+
+			// 'frame' is invalidated by push_back()
+			stack.push_back(eval_frame_t());
+			eval_frame_t &new_frame = stack.back();
+			new_frame.next_item = 0;
+
+			if (frame_port_idx < 0) {
+				new_frame.mux_idx = frame_mux_idx;
+				new_frame.port_idx = item;
+				enter_mux_port(new_frame);
+			} else {
+				new_frame.mux_idx = item;
+				new_frame.port_idx = -1;
+				enter_mux(new_frame);
+			}
+		}
+
+		knowledge.visited_muxes[mux_idx] = false;
 	}
 };
 
@@ -69,8 +69,7 @@ struct OptShareWorker
 		const std::map<RTLIL::IdString, RTLIL::SigSpec> *conn = &cell->connections;
 		std::map<RTLIL::IdString, RTLIL::SigSpec> alt_conn;
 
-		if (cell->type == "$and" || cell->type == "$or" || cell->type == "$xor" || cell->type == "$xnor" || cell->type == "$add" || cell->type == "$mul" ||
-				cell->type == "$logic_and" || cell->type == "$logic_or" || cell->type == "$_AND_" || cell->type == "$_OR_" || cell->type == "$_XOR_") {
+		if (ct.cell_commutative(cell->type)) {
 			alt_conn = *conn;
 			if (assign_map(alt_conn.at("\\A")) < assign_map(alt_conn.at("\\B"))) {
 				alt_conn["\\A"] = conn->at("\\B");
@@ -152,8 +151,7 @@ struct OptShareWorker
 				assign_map.apply(it.second);
 		}
 
-		if (cell1->type == "$and" || cell1->type == "$or" || cell1->type == "$xor" || cell1->type == "$xnor" || cell1->type == "$add" || cell1->type == "$mul" ||
-				cell1->type == "$logic_and" || cell1->type == "$logic_or" || cell1->type == "$_AND_" || cell1->type == "$_OR_" || cell1->type == "$_XOR_") {
+		if (ct.cell_commutative(cell1->type)) {
 			if (conn1.at("\\A") < conn1.at("\\B")) {
 				RTLIL::SigSpec tmp = conn1["\\A"];
 				conn1["\\A"] = conn1["\\B"];
@@ -0,0 +1,736 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// [[CITE]] Parallel prefix adders
+// Kogge, P. M. and Stone, H. S. (1973), "A Parallel Algorithm for the Efficient Solution of a General Class of Recurrence Equations", IEEE Transactions on Computers C-22 (8): 786-793
+// Brent, R. P. and Kung, H. T. (1982), "A Regular Layout for Parallel Adders", IEEE Transactions on Computers C-31 (3): 260-264
+// Han, T. and Carlson, D. A. (1987), "Fast area-efficient VLSI adders", 8th IEEE Symposium on Computer Arithmetic, pp. 49-56
+
+#include "kernel/register.h"
+#include "kernel/sigtools.h"
+#include "kernel/log.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+struct ArithmapWorker
+{
+	RTLIL::Module *module;
+	std::string arch, mul_tree;
+	bool mul_booth;
+
+	ArithmapWorker(RTLIL::Module *module, std::string arch) : module(module), arch(arch), mul_tree("dadda"), mul_booth(false) { }
+
+	static bool is_const(const RTLIL::SigBit &bit, RTLIL::State value)
+	{
+		return bit.wire == NULL && bit.data == value;
+	}
+
+	RTLIL::SigBit add_gate(std::string type, RTLIL::SigBit a, RTLIL::SigBit b = RTLIL::State::Sx)
+	{
+		RTLIL::Wire *wire = module->new_wire(1, NEW_ID);
+
+		RTLIL::Cell *gate = new RTLIL::Cell;
+		gate->name = NEW_ID;
+		gate->type = type;
+		gate->connections["\\A"] = a;
+		if (type != "$_INV_")
+			gate->connections["\\B"] = b;
+		gate->connections["\\Y"] = wire;
+		module->add(gate);
+
+		return wire;
+	}
+
+	RTLIL::SigBit not_gate(RTLIL::SigBit a)
+	{
+		if (is_const(a, RTLIL::State::S0))
+			return RTLIL::State::S1;
+		if (is_const(a, RTLIL::State::S1))
+			return RTLIL::State::S0;
+		return add_gate("$_INV_", a);
+	}
+
+	RTLIL::SigBit and_gate(RTLIL::SigBit a, RTLIL::SigBit b)
+	{
+		if (is_const(a, RTLIL::State::S0) || is_const(b, RTLIL::State::S0))
+			return RTLIL::State::S0;
+		if (is_const(a, RTLIL::State::S1))
+			return b;
+		if (is_const(b, RTLIL::State::S1))
+			return a;
+		return add_gate("$_AND_", a, b);
+	}
+
+	RTLIL::SigBit or_gate(RTLIL::SigBit a, RTLIL::SigBit b)
+	{
+		if (is_const(a, RTLIL::State::S1) || is_const(b, RTLIL::State::S1))
+			return RTLIL::State::S1;
+		if (is_const(a, RTLIL::State::S0))
+			return b;
+		if (is_const(b, RTLIL::State::S0))
+			return a;
+		return add_gate("$_OR_", a, b);
+	}
+
+	RTLIL::SigBit xor_gate(RTLIL::SigBit a, RTLIL::SigBit b)
+	{
+		if (is_const(a, RTLIL::State::S0))
+			return b;
+		if (is_const(b, RTLIL::State::S0))
+			return a;
+		if (is_const(a, RTLIL::State::S1))
+			return not_gate(b);
+		if (is_const(b, RTLIL::State::S1))
+			return not_gate(a);
+		return add_gate("$_XOR_", a, b);
+	}
+
+	RTLIL::SigBit mux_gate(RTLIL::SigBit a, RTLIL::SigBit b, RTLIL::SigBit s)
+	{
+		if (is_const(s, RTLIL::State::S0) || a == b)
+			return a;
+		if (is_const(s, RTLIL::State::S1))
+			return b;
+
+		RTLIL::Wire *wire = module->new_wire(1, NEW_ID);
+
+		RTLIL::Cell *gate = new RTLIL::Cell;
+		gate->name = NEW_ID;
+		gate->type = "$_MUX_";
+		gate->connections["\\A"] = a;
+		gate->connections["\\B"] = b;
+		gate->connections["\\S"] = s;
+		gate->connections["\\Y"] = wire;
+		module->add(gate);
+
+		return wire;
+	}
+
+	// balanced tree of and gates (the identity for an empty vector is 1)
+	RTLIL::SigBit and_reduce(std::vector<RTLIL::SigBit> bits)
+	{
+		if (bits.size() == 0)
+			return RTLIL::State::S1;
+		while (bits.size() > 1) {
+			std::vector<RTLIL::SigBit> next_bits;
+			for (size_t i = 0; i+1 < bits.size(); i += 2)
+				next_bits.push_back(and_gate(bits[i], bits[i+1]));
+			if (bits.size() % 2 == 1)
+				next_bits.push_back(bits.back());
+			bits.swap(next_bits);
+		}
+		return bits.front();
+	}
+
+	// balanced tree of or gates (the identity for an empty vector is 0)
+	RTLIL::SigBit or_reduce(std::vector<RTLIL::SigBit> bits)
+	{
+		if (bits.size() == 0)
+			return RTLIL::State::S0;
+		while (bits.size() > 1) {
+			std::vector<RTLIL::SigBit> next_bits;
+			for (size_t i = 0; i+1 < bits.size(); i += 2)
+				next_bits.push_back(or_gate(bits[i], bits[i+1]));
+			if (bits.size() % 2 == 1)
+				next_bits.push_back(bits.back());
+			bits.swap(next_bits);
+		}
+		return bits.front();
+	}
+
+	// The group generate/propagate signals (G[i], P[i]) of the bits i..j are
+	// combined with those of the bits j-1..k to the group signals of the bits
+	// i..k by the usual prefix operator: (G[i] | P[i] & G[j-1], P[i] & P[j-1])
+	void prefix_op(std::vector<RTLIL::SigBit> &G, std::vector<RTLIL::SigBit> &P, int i, int j)
+	{
+		G[i] = or_gate(G[i], and_gate(P[i], G[j]));
+		P[i] = and_gate(P[i], P[j]);
+	}
+
+	// On return G[i] is the carry out of bit i
+	void prefix_carries(std::vector<RTLIL::SigBit> &G, std::vector<RTLIL::SigBit> &P)
+	{
+		int width = G.size();
+
+		if (arch == "ripple")
+		{
+			for (int i = 1; i < width; i++)
+				prefix_op(G, P, i, i-1);
+			return;
+		}
+
+		if (arch == "ks")
+		{
+			// Kogge-Stone: log2(width) levels, every bit is updated on every level
+			for (int d = 1; d < width; d *= 2) {
+				std::vector<RTLIL::SigBit> G_prev = G, P_prev = P;
+				for (int i = d; i < width; i++) {
+					G[i] = or_gate(G_prev[i], and_gate(P_prev[i], G_prev[i-d]));
+					P[i] = and_gate(P_prev[i], P_prev[i-d]);
+				}
+			}
+			return;
+		}
+
+		if (arch == "bk")
+		{
+			// Brent-Kung: an up-sweep tree followed by a down-sweep tree
+			int top = 1;
+			for (int d = 1; d < width; d *= 2) {
+				for (int i = 2*d-1; i < width; i += 2*d)
+					prefix_op(G, P, i, i-d);
+				top = d;
+			}
+			for (int d = top; d >= 1; d /= 2)
+				for (int i = 3*d-1; i < width; i += 2*d)
+					prefix_op(G, P, i, i-d);
+			return;
+		}
+
+		if (arch == "hc")
+		{
+			// Han-Carlson: Kogge-Stone on the odd bits, followed by one
+			// additional level for the even bits
+			for (int i = 1; i < width; i += 2)
+				prefix_op(G, P, i, i-1);
+			for (int d = 2; d < width; d *= 2) {
+				std::vector<RTLIL::SigBit> G_prev = G, P_prev = P;
+				for (int i = d+1; i < width; i += 2) {
+					G[i] = or_gate(G_prev[i], and_gate(P_prev[i], G_prev[i-d]));
+					P[i] = and_gate(P_prev[i], P_prev[i-d]);
+				}
+			}
+			for (int i = 2; i < width; i += 2)
+				prefix_op(G, P, i, i-1);
+			return;
+		}
+
+		log_abort();
+	}
+
+	// Y = A + B + CI, the vectors A and B must have the same width. The carry
+	// out of every bit is returned in CO and A ^ B is returned in X.
+	void add(const std::vector<RTLIL::SigBit> &A, const std::vector<RTLIL::SigBit> &B, RTLIL::SigBit CI,
+			std::vector<RTLIL::SigBit> &Y, std::vector<RTLIL::SigBit> &CO, std::vector<RTLIL::SigBit> *X_ptr = NULL)
+	{
+		int width = A.size();
+		assert(int(B.size()) == width);
+
+		std::vector<RTLIL::SigBit> G(width), P(width), X(width);
+		for (int i = 0; i < width; i++) {
+			X[i] = xor_gate(A[i], B[i]);
+			G[i] = and_gate(A[i], B[i]);
+			P[i] = X[i];
+		}
+
+		if (width > 0)
+			G[0] = or_gate(G[0], and_gate(P[0], CI));
+
+		prefix_carries(G, P);
+
+		Y.resize(width);
+		for (int i = 0; i < width; i++)
+			Y[i] = xor_gate(X[i], i ? G[i-1] : CI);
+		CO = G;
+
+		if (X_ptr != NULL)
+			*X_ptr = X;
+	}
+
+	std::vector<RTLIL::SigBit> get_port(RTLIL::Cell *cell, std::string port, int width, bool is_signed, bool extend_u0 = false)
+	{
+		RTLIL::SigSpec sig = cell->connections.at(port);
+		if (extend_u0)
+			sig.extend_u0(width, is_signed);
+		else
+			sig.extend(width, is_signed);
+		return sig.to_sigbit_vector();
+	}
+
+	void connect_result(RTLIL::Cell *cell, RTLIL::SigBit result)
+	{
+		RTLIL::SigSpec sig_y = result;
+		sig_y.extend(cell->parameters.at("\\Y_WIDTH").as_int(), false);
+		module->connections.push_back(RTLIL::SigSig(cell->connections.at("\\Y"), sig_y));
+	}
+
+	std::vector<RTLIL::SigBit> invert(const std::vector<RTLIL::SigBit> &bits)
+	{
+		std::vector<RTLIL::SigBit> result;
+		for (auto &bit : bits)
+			result.push_back(not_gate(bit));
+		return result;
+	}
+
+	void map_addsub(RTLIL::Cell *cell)
+	{
+		int width = cell->parameters.at("\\Y_WIDTH").as_int();
+		bool is_sub = cell->type == "$sub";
+
+		bool is_signed = cell->parameters.at("\\A_SIGNED").as_bool() && cell->parameters.at("\\B_SIGNED").as_bool();
+
+		std::vector<RTLIL::SigBit> A = get_port(cell, "\\A", width, is_signed);
+		std::vector<RTLIL::SigBit> B = get_port(cell, "\\B", width, is_signed);
+		std::vector<RTLIL::SigBit> Y, CO;
+
+		if (is_sub)
+			B = invert(B);
+		add(A, B, is_sub ? RTLIL::State::S1 : RTLIL::State::S0, Y, CO);
+
+		module->connections.push_back(RTLIL::SigSig(cell->connections.at("\\Y"), Y));
+	}
+
+	void map_compare(RTLIL::Cell *cell)
+	{
+		bool is_signed = cell->parameters.at("\\A_SIGNED").as_bool() && cell->parameters.at("\\B_SIGNED").as_bool();
+		int a_width = cell->parameters.at("\\A_WIDTH").as_int();
+		int b_width = cell->parameters.at("\\B_WIDTH").as_int();
+		int width = std::max(a_width, b_width);
+
+		std::vector<RTLIL::SigBit> A = get_port(cell, "\\A", width, is_signed);
+		std::vector<RTLIL::SigBit> B = get_port(cell, "\\B", width, is_signed);
+
+		// A > B and A >= B are mapped as B < A and B <= A
+		if (cell->type == "$gt" || cell->type == "$ge")
+			A.swap(B);
+
+		// A - B = A + ~B + 1, the flags are computed like in the $lt and $le
+		// cells in stdcells.v
+		std::vector<RTLIL::SigBit> Y, CO, X;
+		add(A, invert(B), RTLIL::State::S1, Y, CO, &X);
+
+		RTLIL::SigBit lt;
+		if (is_signed) {
+			RTLIL::SigBit of = xor_gate(CO[width-1], width > 1 ? CO[width-2] : RTLIL::State::S1);
+			lt = xor_gate(of, Y[width-1]);
+		} else
+			lt = not_gate(CO[width-1]);
+
+		RTLIL::SigBit result = lt;
+		if (cell->type == "$le" || cell->type == "$ge") {
+			// A == B iff all bits of A ^ ~B are set
+			RTLIL::SigBit zf = and_reduce(X);
+			result = or_gate(lt, zf);
+		}
+
+		connect_result(cell, result);
+	}
+
+	void map_neg(RTLIL::Cell *cell)
+	{
+		int width = cell->parameters.at("\\Y_WIDTH").as_int();
+
+		// -A = ~A + 1
+		std::vector<RTLIL::SigBit> A = get_port(cell, "\\A", width, cell->parameters.at("\\A_SIGNED").as_bool());
+		std::vector<RTLIL::SigBit> Y, CO;
+		add(std::vector<RTLIL::SigBit>(width, RTLIL::State::S0), invert(A), RTLIL::State::S1, Y, CO);
+
+		module->connections.push_back(RTLIL::SigSig(cell->connections.at("\\Y"), Y));
+	}
+
+	void map_equal(RTLIL::Cell *cell)
+	{
+		bool is_signed = cell->parameters.at("\\A_SIGNED").as_bool() && cell->parameters.at("\\B_SIGNED").as_bool();
+		int width = std::max(cell->parameters.at("\\A_WIDTH").as_int(), cell->parameters.at("\\B_WIDTH").as_int());
+
+		std::vector<RTLIL::SigBit> A = get_port(cell, "\\A", width, is_signed, true);
+		std::vector<RTLIL::SigBit> B = get_port(cell, "\\B", width, is_signed, true);
+
+		std::vector<RTLIL::SigBit> X;
+		for (int i = 0; i < width; i++)
+			X.push_back(xor_gate(A[i], B[i]));
+
+		RTLIL::SigBit result = or_reduce(X);
+		if (cell->type == "$eq" || cell->type == "$eqx")
+			result = not_gate(result);
+
+		connect_result(cell, result);
+	}
+
+	// barrel shifter with one stage of muxes per bit of the shift amount
+	void map_shift(RTLIL::Cell *cell)
+	{
+		bool a_signed = cell->parameters.at("\\A_SIGNED").as_bool();
+		bool shift_left = cell->type == "$shl" || cell->type == "$sshl";
+		bool sign_fill = a_signed && (cell->type == "$sshl" || cell->type == "$sshr");
+		int a_width = cell->parameters.at("\\A_WIDTH").as_int();
+		int y_width = cell->parameters.at("\\Y_WIDTH").as_int();
+		int width = std::max(a_width, y_width);
+
+		std::vector<RTLIL::SigBit> A = get_port(cell, "\\A", width, a_signed, true);
+		std::vector<RTLIL::SigBit> B = cell->connections.at("\\B").to_sigbit_vector();
+
+		// bits shifted in at the top (for right shifts) or bottom (for left shifts)
+		RTLIL::SigBit fill = sign_fill ? A.back() : RTLIL::SigBit(RTLIL::State::S0);
+
+		// the bits of B that can shift by less than the width get a stage of
+		// muxes, the remaining bits of B shift out everything
+		int stages = 0;
+		while (stages < int(B.size()) && (1 << stages) < width && stages < 30)
+			stages++;
+
+		// the number of bits that are needed after each stage: output bit j of a
+		// left shift only depends on bits 0..j of the input, output bit j of a
+		// right shift depends on the bits up to j plus the largest shift amount
+		// of the following stages (stages with a constant zero select are free)
+		std::vector<int> stage_width(stages+1, y_width);
+		for (int i = stages-1; i >= 0; i--) {
+			int dist = 1 << i;
+			if (!shift_left && !is_const(B[i], RTLIL::State::S0))
+				stage_width[i] = std::min(width, stage_width[i+1] + dist);
+			else
+				stage_width[i] = stage_width[i+1];
+		}
+		A.resize(stage_width[0]);
+
+		for (int i = 0; i < stages; i++)
+		{
+			if (is_const(B[i], RTLIL::State::S0)) {
+				A.resize(stage_width[i+1]);
+				continue;
+			}
+
+			int dist = 1 << i;
+			std::vector<RTLIL::SigBit> next_A(stage_width[i+1]);
+
+			for (int j = 0; j < stage_width[i+1]; j++) {
+				int k = shift_left ? j - dist : j + dist;
+				RTLIL::SigBit shifted = k < 0 ? RTLIL::SigBit(RTLIL::State::S0) : k >= width ? fill : A[k];
+				next_A[j] = mux_gate(A[j], shifted, B[i]);
+			}
+
+			A.swap(next_A);
+		}
+
+		RTLIL::SigBit overflow = or_reduce(std::vector<RTLIL::SigBit>(B.begin() + stages, B.end()));
+		RTLIL::SigBit overflow_fill = shift_left ? RTLIL::SigBit(RTLIL::State::S0) : fill;
+
+		std::vector<RTLIL::SigBit> Y;
+		for (int j = 0; j < y_width; j++)
+			Y.push_back(mux_gate(A[j], overflow_fill, overflow));
+
+		module->connections.push_back(RTLIL::SigSig(cell->connections.at("\\Y"), Y));
+	}
+
+	void full_adder(RTLIL::SigBit a, RTLIL::SigBit b, RTLIL::SigBit c, RTLIL::SigBit &sum, RTLIL::SigBit &carry)
+	{
+		RTLIL::SigBit t = xor_gate(a, b);
+		sum = xor_gate(t, c);
+		carry = or_gate(and_gate(a, b), and_gate(t, c));
+	}
+
+	void half_adder(RTLIL::SigBit a, RTLIL::SigBit b, RTLIL::SigBit &sum, RTLIL::SigBit &carry)
+	{
+		sum = xor_gate(a, b);
+		carry = and_gate(a, b);
+	}
+
+	// Add the partial products in cols[k] (the bits of weight 2^k) to the
+	// columns of A*B. All results are truncated to the number of columns.
+	void add_partial_products(const std::vector<RTLIL::SigBit> &A, const std::vector<RTLIL::SigBit> &B,
+			std::vector<std::vector<RTLIL::SigBit>> &cols)
+	{
+		int width = cols.size();
+
+		if (!mul_booth) {
+			for (int j = 0; j < width; j++)
+			for (int i = 0; i+j < width; i++)
+				cols[i+j].push_back(and_gate(A[i], B[j]));
+			return;
+		}
+
+		// Radix-4 Booth encoding: B = sum(d[j] * 4^j) with d[j] in {-2, -1, 0, 1, 2}
+		// and d[j] = -2*B[2j+1] + B[2j] + B[2j-1]. B is sign extended, this does not
+		// change the product because everything is computed modulo 2^width.
+		auto get_b = [&](int i) -> RTLIL::SigBit {
+			return i < 0 ? RTLIL::SigBit(RTLIL::State::S0) : B[std::min(i, width-1)];
+		};
+
+		for (int j = 0; 2*j < width; j++)
+		{
+			RTLIL::SigBit b0 = get_b(2*j-1), b1 = get_b(2*j), b2 = get_b(2*j+1);
+
+			RTLIL::SigBit one = xor_gate(b1, b0);
+			RTLIL::SigBit two = and_gate(xor_gate(b2, b1), not_gate(one));
+			RTLIL::SigBit neg = b2;
+
+			// -x = ~x + 1, the +1 is added as an extra partial product bit
+			for (int i = 0; 2*j+i < width; i++) {
+				RTLIL::SigBit m = or_gate(and_gate(one, A[i]), and_gate(two, i ? A[i-1] : RTLIL::SigBit(RTLIL::State::S0)));
+				cols[2*j+i].push_back(xor_gate(m, neg));
+			}
+			cols[2*j].push_back(neg);
+		}
+	}
+
+	// Reduce the columns to at most two bits each
+	void reduce_columns(std::vector<std::vector<RTLIL::SigBit>> &cols)
+	{
+		int width = cols.size();
+
+		for (auto &col : cols) {
+			std::vector<RTLIL::SigBit> new_col;
+			for (auto &bit : col)
+				if (!is_const(bit, RTLIL::State::S0))
+					new_col.push_back(bit);
+			col.swap(new_col);
+		}
+
+		int max_height = 0;
+		for (auto &col : cols)
+			max_height = std::max(max_height, int(col.size()));
+
+		// Dadda reduces the columns to the heights 2, 3, 4, 6, 9, 13, ..
+		// using as few adders as possible in every stage
+		std::vector<int> dadda_heights;
+		for (int d = 2; d < max_height; d = d * 3 / 2)
+			dadda_heights.push_back(d);
+
+		while (max_height > 2)
+		{
+			std::vector<std::vector<RTLIL::SigBit>> new_cols(width);
+			int target = 2;
+
+			if (mul_tree == "dadda" && dadda_heights.size() > 0) {
+				target = dadda_heights.back();
+				dadda_heights.pop_back();
+			}
+
+			for (int k = 0; k < width; k++)
+			{
+				std::vector<RTLIL::SigBit> &col = cols[k];
+				RTLIL::SigBit sum, carry;
+				int idx = 0, count = col.size();
+
+				while (count - idx >= 2)
+				{
+					if (mul_tree == "wallace") {
+						// Wallace: use as many full adders as possible, and a half adder
+						// for the remaining two bits if the column would be too high
+						if (count - idx >= 3) {
+							full_adder(col[idx], col[idx+1], col[idx+2], sum, carry);
+							idx += 3;
+						} else if (count - idx + int(new_cols[k].size()) > 2) {
+							half_adder(col[idx], col[idx+1], sum, carry);
+							idx += 2;
+						} else
+							break;
+					} else {
+						// Dadda: only reduce the column to the target height
+						int height = count - idx + int(new_cols[k].size());
+						if (height <= target)
+							break;
+						if (height - target >= 2 && count - idx >= 3) {
+							full_adder(col[idx], col[idx+1], col[idx+2], sum, carry);
+							idx += 3;
+						} else {
+							half_adder(col[idx], col[idx+1], sum, carry);
+							idx += 2;
+						}
+					}
+
+					new_cols[k].push_back(sum);
+					if (k+1 < width)
+						new_cols[k+1].push_back(carry);
+				}
+
+				new_cols[k].insert(new_cols[k].end(), col.begin() + idx, col.end());
+			}
+
+			cols.swap(new_cols);
+
+			max_height = 0;
+			for (auto &col : cols)
+				max_height = std::max(max_height, int(col.size()));
+		}
+	}
+
+	void map_mul(RTLIL::Cell *cell)
+	{
+		int width = cell->parameters.at("\\Y_WIDTH").as_int();
+		bool is_signed = cell->parameters.at("\\A_SIGNED").as_bool() && cell->parameters.at("\\B_SIGNED").as_bool();
+
+		// the product is computed modulo 2^width, so signed operands only need
+		// to be sign extended to the output width
+		std::vector<RTLIL::SigBit> A = get_port(cell, "\\A", width, is_signed);
+		std::vector<RTLIL::SigBit> B = get_port(cell, "\\B", width, is_signed);
+
+		std::vector<std::vector<RTLIL::SigBit>> cols(width);
+		add_partial_products(A, B, cols);
+		reduce_columns(cols);
+
+		std::vector<RTLIL::SigBit> X(width, RTLIL::State::S0), Z(width, RTLIL::State::S0), Y, CO;
+		for (int k = 0; k < width; k++) {
+			if (cols[k].size() > 0)
+				X[k] = cols[k][0];
+			if (cols[k].size() > 1)
+				Z[k] = cols[k][1];
+		}
+		add(X, Z, RTLIL::State::S0, Y, CO);
+
+		module->connections.push_back(RTLIL::SigSig(cell->connections.at("\\Y"), Y));
+	}
+
+	bool map(RTLIL::Cell *cell)
+	{
+		if (cell->type == "$add" || cell->type == "$sub") {
+			map_addsub(cell);
+			return true;
+		}
+
+		if (cell->type == "$lt" || cell->type == "$le" || cell->type == "$gt" || cell->type == "$ge") {
+			map_compare(cell);
+			return true;
+		}
+
+		if (cell->type == "$mul") {
+			map_mul(cell);
+			return true;
+		}
+
+		if (cell->type == "$neg") {
+			map_neg(cell);
+			return true;
+		}
+
+		if (cell->type == "$eq" || cell->type == "$ne" || cell->type == "$eqx" || cell->type == "$nex") {
+			map_equal(cell);
+			return true;
+		}
+
+		if (cell->type == "$shl" || cell->type == "$shr" || cell->type == "$sshl" || cell->type == "$sshr") {
+			map_shift(cell);
+			return true;
+		}
+
+		return false;
+	}
+};
+
+// used by techmap for the techmap_simplemap stubs of these cells in stdcells.v
+static void arithmap_simplemap(RTLIL::Module *module, RTLIL::Cell *cell)
+{
+	ArithmapWorker worker(module, "ripple");
+	if (!worker.map(cell))
+		log_abort();
+}
+
+void arithmap_get_mappers(std::map<std::string, void(*)(RTLIL::Module*, RTLIL::Cell*)> &mappers)
+{
+	for (auto type : { "$add", "$sub", "$neg", "$lt", "$le", "$gt", "$ge", "$eq", "$ne", "$eqx", "$nex", "$shl", "$shr", "$sshl", "$sshr" })
+		mappers[type] = arithmap_simplemap;
+}
+
+struct ArithmapPass : public Pass {
+	ArithmapPass() : Pass("arithmap", "map arithmetic cells to gate primitives") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    arithmap [options] [selection]\n");
+		log("\n");
+		log("This pass maps arithmetic cells directly to yosys gate primitives. The\n");
+		log("'techmap' pass uses the same mappers with ripple carry adders (except for $mul,\n");
+		log("that is mapped by techmap using stdcells.v). The following internal cell types\n");
+		log("are mapped by this pass:\n");
+		log("\n");
+		log("  $add, $sub, $neg, $mul, $lt, $le, $gt, $ge, $eq, $ne, $eqx, $nex\n");
+		log("  $shl, $shr, $sshl, $sshr\n");
+		log("\n");
+		log("Shift cells are mapped to barrel shifters with one stage of $_MUX_ cells for\n");
+		log("each bit of the shift amount. Stages for constant bits of the shift amount are\n");
+		log("removed and only the bits that are needed for the output are computed.\n");
+		log("\n");
+		log("    -arch <architecture>\n");
+		log("        select the carry network for adders, subtractors and comparators:\n");
+		log("\n");
+		log("            ripple  ripple carry chain (depth n, n cells)\n");
+		log("            ks      Kogge-Stone adder (depth log2(n), n*log2(n) cells)\n");
+		log("            bk      Brent-Kung adder (depth 2*log2(n), 2*n cells)\n");
+		log("            hc      Han-Carlson adder (depth log2(n)+1, n*log2(n)/2 cells)\n");
+		log("\n");
+		log("        The default is 'bk'.\n");
+		log("\n");
+		log("    -booth\n");
+		log("        use radix-4 Booth encoding for the partial products of multipliers.\n");
+		log("        This halves the number of partial products at the cost of a more\n");
+		log("        complex partial product generator.\n");
+		log("\n");
+		log("    -mul_tree <wallace|dadda>\n");
+		log("        select the compressor tree that adds up the partial products of\n");
+		log("        multipliers. The final addition of the two remaining rows uses the\n");
+		log("        adder selected with -arch. The default is 'dadda'.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		log_header("Executing ARITHMAP pass (map arithmetic cells to gate primitives).\n");
+
+		std::string arch = "bk";
+		std::string mul_tree = "dadda";
+		bool mul_booth = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-arch" && argidx+1 < args.size()) {
+				arch = args[++argidx];
+				if (arch != "ripple" && arch != "ks" && arch != "bk" && arch != "hc")
+					log_cmd_error("Unsupported adder architecture `%s'.\n", arch.c_str());
+				continue;
+			}
+			if (args[argidx] == "-booth") {
+				mul_booth = true;
+				continue;
+			}
+			if (args[argidx] == "-mul_tree" && argidx+1 < args.size()) {
+				mul_tree = args[++argidx];
+				if (mul_tree != "wallace" && mul_tree != "dadda")
+					log_cmd_error("Unsupported multiplier tree `%s'.\n", mul_tree.c_str());
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		for (auto &mod_it : design->modules) {
+			if (!design->selected(mod_it.second))
+				continue;
+			ArithmapWorker worker(mod_it.second, arch);
+			worker.mul_tree = mul_tree;
+			worker.mul_booth = mul_booth;
+			std::vector<RTLIL::Cell*> cells, delete_cells;
+			for (auto &cell_it : mod_it.second->cells)
+				if (design->selected(mod_it.second, cell_it.second))
+					cells.push_back(cell_it.second);
+			for (auto cell : cells) {
+				if (!worker.map(cell))
+					continue;
+				log("Mapping %s.%s (%s).\n", RTLIL::id2cstr(mod_it.first), RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
+				delete_cells.push_back(cell);
+			}
+			for (auto &it : delete_cells) {
+				mod_it.second->cells.erase(it->name);
+				delete it;
+			}
+		}
+	}
+} ArithmapPass;
+
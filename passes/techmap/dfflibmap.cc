@@ -471,29 +471,41 @@ struct DfflibmapPass : public Pass {
 		FILE *f = fopen(liberty_file.c_str(), "r");
 		if (f == NULL)
 			log_cmd_error("Can't open liberty file `%s': %s\n", liberty_file.c_str(), strerror(errno));
-		LibertyParser libparser(f);
+		// only cells with an ff group are considered, so everything else
+		// (e.g. timing and power tables) is skipped when parsing the file
+		LibertyFilter filter;
+		filter.paths.insert("/library");
+		filter.paths.insert("/library/cell");
+		filter.paths.insert("/library/cell/area");
+		filter.paths.insert("/library/cell/ff/*");
+		filter.paths.insert("/library/cell/pin");
+		filter.paths.insert("/library/cell/pin/direction");
+		filter.paths.insert("/library/cell/pin/function");
+		filter.required["/library/cell"].insert("ff");
+
+		LibertyAst *libast = liberty_cache_parse(f, liberty_file, &filter);
 		fclose(f);
 
-		find_cell(libparser.ast, "$_DFF_N_", false, false, false, false);
-		find_cell(libparser.ast, "$_DFF_P_", true, false, false, false);
-
-		find_cell(libparser.ast, "$_DFF_NN0_", false, true, false, false);
-		find_cell(libparser.ast, "$_DFF_NN1_", false, true, false, true);
-		find_cell(libparser.ast, "$_DFF_NP0_", false, true, true, false);
-		find_cell(libparser.ast, "$_DFF_NP1_", false, true, true, true);
-		find_cell(libparser.ast, "$_DFF_PN0_", true, true, false, false);
-		find_cell(libparser.ast, "$_DFF_PN1_", true, true, false, true);
-		find_cell(libparser.ast, "$_DFF_PP0_", true, true, true, false);
-		find_cell(libparser.ast, "$_DFF_PP1_", true, true, true, true);
-
-		find_cell_sr(libparser.ast, "$_DFFSR_NNN_", false, false, false);
-		find_cell_sr(libparser.ast, "$_DFFSR_NNP_", false, false, true);
-		find_cell_sr(libparser.ast, "$_DFFSR_NPN_", false, true, false);
-		find_cell_sr(libparser.ast, "$_DFFSR_NPP_", false, true, true);
-		find_cell_sr(libparser.ast, "$_DFFSR_PNN_", true, false, false);
-		find_cell_sr(libparser.ast, "$_DFFSR_PNP_", true, false, true);
-		find_cell_sr(libparser.ast, "$_DFFSR_PPN_", true, true, false);
-		find_cell_sr(libparser.ast, "$_DFFSR_PPP_", true, true, true);
+		find_cell(libast, "$_DFF_N_", false, false, false, false);
+		find_cell(libast, "$_DFF_P_", true, false, false, false);
+
+		find_cell(libast, "$_DFF_NN0_", false, true, false, false);
+		find_cell(libast, "$_DFF_NN1_", false, true, false, true);
+		find_cell(libast, "$_DFF_NP0_", false, true, true, false);
+		find_cell(libast, "$_DFF_NP1_", false, true, true, true);
+		find_cell(libast, "$_DFF_PN0_", true, true, false, false);
+		find_cell(libast, "$_DFF_PN1_", true, true, false, true);
+		find_cell(libast, "$_DFF_PP0_", true, true, true, false);
+		find_cell(libast, "$_DFF_PP1_", true, true, true, true);
+
+		find_cell_sr(libast, "$_DFFSR_NNN_", false, false, false);
+		find_cell_sr(libast, "$_DFFSR_NNP_", false, false, true);
+		find_cell_sr(libast, "$_DFFSR_NPN_", false, true, false);
+		find_cell_sr(libast, "$_DFFSR_NPP_", false, true, true);
+		find_cell_sr(libast, "$_DFFSR_PNN_", true, false, false);
+		find_cell_sr(libast, "$_DFFSR_PNP_", true, false, true);
+		find_cell_sr(libast, "$_DFFSR_PPN_", true, true, false);
+		find_cell_sr(libast, "$_DFFSR_PPP_", true, true, true);
 
 		// try to implement as many cells as possible just by inverting
 		// the SET and RESET pins. If necessary, implement cell types
@@ -386,6 +386,12 @@ struct ExtractPass : public Pass {
 		log("    -verbose\n");
 		log("        print debug output while analyzing\n");
 		log("\n");
+		log("    -j <num_threads>\n");
+		log("        run the solver on different modules of the design in parallel using\n");
+		log("        the specified number of threads. in -mine mode the candidate\n");
+		log("        subcircuits are tested in parallel. the result is the same as\n");
+		log("        without this option. (ignored when -verbose is used)\n");
+		log("\n");
 		log("    -constports\n");
 		log("        also find instances with constant drivers. this may be much\n");
 		log("        slower than the normal operation.\n");
@@ -463,6 +469,7 @@ struct ExtractPass : public Pass {
 		std::string mine_outfile;
 		bool constports = false;
 		bool nodefaultswaps = false;
+		int num_threads = 1;
 
 		bool mine_mode = false;
 		int mine_cells_min = 3;
@@ -513,6 +520,12 @@ struct ExtractPass : public Pass {
 				solver.setVerbose();
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_threads = atoi(args[++argidx].c_str());
+				if (num_threads < 1)
+					cmd_error(args, argidx, "Number of threads must be positive.");
+				continue;
+			}
 			if (args[argidx] == "-constports") {
 				constports = true;
 				continue;
@@ -671,11 +684,13 @@ struct ExtractPass : public Pass {
 
 			std::sort(needle_list.begin(), needle_list.end(), compareSortNeedleList);
 
+			std::vector<SubCircuit::Solver::SolveJob> jobs;
 			for (auto needle : needle_list)
 			for (auto &haystack_it : haystack_map) {
 				log("Solving for %s in %s.\n", ("needle_" + RTLIL::unescape_id(needle->name)).c_str(), haystack_it.first.c_str());
-				solver.solve(results, "needle_" + RTLIL::unescape_id(needle->name), haystack_it.first, false);
+				jobs.push_back(SubCircuit::Solver::SolveJob("needle_" + RTLIL::unescape_id(needle->name), haystack_it.first));
 			}
+			solver.solve(results, jobs, num_threads, false);
 			log("Found %zd matches.\n", results.size());
 
 			if (results.size() > 0)
@@ -702,7 +717,7 @@ struct ExtractPass : public Pass {
 			std::vector<SubCircuit::Solver::MineResult> results;
 
 			log_header("Running miner from SubCircuit library.\n");
-			solver.mine(results, mine_cells_min, mine_cells_max, mine_min_freq, mine_limit_mod);
+			solver.mine(results, mine_cells_min, mine_cells_max, mine_min_freq, mine_limit_mod, num_threads);
 
 			map = new RTLIL::Design;
 
@@ -23,6 +23,10 @@
 
 #ifndef FILTERLIB
 #include "kernel/log.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <map>
 #endif
 
 using namespace PASS_DFFLIBMAP;
@@ -80,87 +84,172 @@ void LibertyAst::dump(FILE *f, std::string indent, std::string path, bool path_o
 		fprintf(f, " ;\n");
 }
 
+LibertyParser::LibertyParser(FILE *f, const LibertyFilter *filter) : line(1), filter(filter)
+{
+	char block[64*1024];
+	size_t n;
+	while ((n = fread(block, 1, sizeof(block), f)) > 0)
+		buffer.append(block, n);
+	p = buffer.data();
+	end = p + buffer.size();
+	ast = parse();
+}
+
+LibertyParser::LibertyParser(const char *data, size_t size, const LibertyFilter *filter) :
+		p(data), end(data + size), line(1), filter(filter)
+{
+	ast = parse();
+}
+
+static inline bool is_id_char(int c)
+{
+	return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.';
+}
+
 int LibertyParser::lexer(std::string &str)
 {
 	int c;
 
-	do {
-		c = fgetc(f);
-	} while (c == ' ' || c == '\t' || c == '\r');
-
-	if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.') {
-		str = c;
-		while (1) {
-			c = fgetc(f);
-			if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.')
-				str += c;
-			else
-				break;
+	// the input is scanned in place, tokens are only copied to 'str' as a whole
+	while (1)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+
+		if (p == end)
+			return EOF;
+		c = (unsigned char)*(p++);
+
+		if (is_id_char(c)) {
+			const char *start = p-1;
+			while (p < end && is_id_char((unsigned char)*p))
+				p++;
+			str.assign(start, p-start);
+			// fprintf(stderr, "LEX: identifier >>%s<<\n", str.c_str());
+			return 'v';
+		}
+
+		if (c == '"') {
+			const char *start = p-1;
+			while (p < end && *p != '"') {
+				if (*p == '\n')
+					line++;
+				p++;
+			}
+			if (p < end)
+				p++;
+			str.assign(start, p-start);
+			// fprintf(stderr, "LEX: string >>%s<<\n", str.c_str());
+			return 'v';
 		}
-		ungetc(c, f);
-		// fprintf(stderr, "LEX: identifier >>%s<<\n", str.c_str());
-		return 'v';
-	}
 
-	if (c == '"') {
-		str = c;
-		while (1) {
-			c = fgetc(f);
-			if (c == '\n')
+		if (c == '/') {
+			if (p < end && *p == '*') {
+				int last_c = *(p++);
+				while (p < end) {
+					c = (unsigned char)*(p++);
+					if (c == '\n')
+						line++;
+					if (last_c == '*' && c == '/')
+						break;
+					last_c = c;
+				}
+				continue;
+			} else if (p < end && *p == '/') {
+				while (p < end && *p != '\n')
+					p++;
+				if (p < end)
+					p++;
 				line++;
-			str += c;
-			if (c == '"')
-				break;
+				continue;
+			}
+			// fprintf(stderr, "LEX: char >>/<<\n");
+			return '/';
 		}
-		// fprintf(stderr, "LEX: string >>%s<<\n", str.c_str());
-		return 'v';
-	}
 
-	if (c == '/') {
-		c = fgetc(f);
-		if (c == '*') {
-			int last_c = 0;
-			while (c > 0 && (last_c != '*' || c != '/')) {
-				last_c = c;
-				c = fgetc(f);
-				if (c == '\n')
-					line++;
+		if (c == '\\') {
+			if (p < end && *p == '\r')
+				p++;
+			if (p < end && *p == '\n') {
+				p++;
+				line++;
+				continue;
 			}
-			return lexer(str);
-		} else if (c == '/') {
-			while (c > 0 && c != '\n')
-				c = fgetc(f);
+			return '\\';
+		}
+
+		if (c == '\n') {
 			line++;
-			return lexer(str);
+			return ';';
 		}
-		ungetc(c, f);
-		// fprintf(stderr, "LEX: char >>/<<\n");
-		return '/';
-	}
 
-	if (c == '\\') {
-		c = fgetc(f);
-		if (c == '\r')
-			c = fgetc(f);
-		if (c == '\n')
-			return lexer(str);
-		ungetc(c, f);
-		return '\\';
+		// if (c >= 32 && c < 255)
+		// 	fprintf(stderr, "LEX: char >>%c<<\n", c);
+		// else
+		// 	fprintf(stderr, "LEX: char %d\n", c);
+		return c;
 	}
+}
+
+// skip the rest of a group after its opening brace without lexing it
+void LibertyParser::skip_group()
+{
+	int depth = 1;
+
+	while (p < end)
+	{
+		char c = *(p++);
 
-	if (c == '\n') {
-		line++;
-		return ';';
+		if (c == '\n') {
+			line++;
+		} else if (c == '{') {
+			depth++;
+		} else if (c == '}') {
+			if (--depth == 0)
+				return;
+		} else if (c == '"') {
+			while (p < end && *p != '"') {
+				if (*p == '\n')
+					line++;
+				p++;
+			}
+			if (p < end)
+				p++;
+		} else if (c == '/' && p < end && *p == '*') {
+			int last_c = *(p++);
+			while (p < end) {
+				c = *(p++);
+				if (c == '\n')
+					line++;
+				if (last_c == '*' && c == '/')
+					break;
+				last_c = c;
+			}
+		} else if (c == '/' && p < end && *p == '/') {
+			while (p < end && *p != '\n')
+				p++;
+		}
 	}
+}
 
-	// if (c >= 32 && c < 255)
-	// 	fprintf(stderr, "LEX: char >>%c<<\n", c);
-	// else
-	// 	fprintf(stderr, "LEX: char %d\n", c);
-	return c;
+bool LibertyFilter::keep(const std::string &path, bool path_ok) const
+{
+	return path_ok || paths.count(path) > 0 || paths.count(path + "/*") > 0;
+}
+
+bool LibertyFilter::keep(LibertyAst *ast, const std::string &path, bool path_ok) const
+{
+	if (!keep(path, path_ok))
+		return false;
+	if (required.count(path) == 0)
+		return true;
+	for (auto child : ast->children)
+		if (required.at(path).count(child->id) > 0)
+			return true;
+	return false;
 }
 
-LibertyAst *LibertyParser::parse()
+LibertyAst *LibertyParser::parse(std::string path, bool path_ok)
 {
 	std::string str;
 
@@ -178,6 +267,9 @@ LibertyAst *LibertyParser::parse()
 	LibertyAst *ast = new LibertyAst;
 	ast->id = str;
 
+	if (filter != NULL)
+		path += "/" + str;
+
 	while (1)
 	{
 		tok = lexer(str);
@@ -208,10 +300,19 @@ LibertyAst *LibertyParser::parse()
 		}
 
 		if (tok == '{') {
+			if (filter != NULL && !filter->keep(path, path_ok)) {
+				skip_group();
+				break;
+			}
+			bool child_path_ok = filter != NULL && (path_ok || filter->paths.count(path + "/*") > 0);
 			while (1) {
-				LibertyAst *child = parse();
+				LibertyAst *child = parse(path, child_path_ok);
 				if (child == NULL)
 					break;
+				if (filter != NULL && !filter->keep(child, path + "/" + child->id, child_path_ok)) {
+					delete child;
+					continue;
+				}
 				ast->children.push_back(child);
 			}
 			break;
@@ -230,6 +331,64 @@ void LibertyParser::error()
 	log_error("Syntax error in line %d.\n", line);
 }
 
+struct liberty_cache_entry_t {
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	bool filtered;
+	LibertyFilter filter;
+	LibertyAst *ast;
+};
+
+static std::map<std::string, liberty_cache_entry_t> liberty_cache;
+
+LibertyAst *PASS_DFFLIBMAP::liberty_cache_parse(FILE *f, std::string filename, const LibertyFilter *filter)
+{
+	struct stat st;
+	bool regular_file = fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode);
+
+	if (regular_file && liberty_cache.count(filename) > 0) {
+		liberty_cache_entry_t &entry = liberty_cache.at(filename);
+		if (entry.dev == st.st_dev && entry.ino == st.st_ino && entry.size == st.st_size && entry.mtime == st.st_mtime &&
+				(!entry.filtered || (filter != NULL && entry.filter == *filter))) {
+			log("Using cached AST for liberty file `%s'.\n", filename.c_str());
+			return entry.ast;
+		}
+	}
+
+	if (liberty_cache.count(filename) > 0) {
+		delete liberty_cache.at(filename).ast;
+		liberty_cache.erase(filename);
+	}
+
+	// regular files are mapped into memory and lexed in place,
+	// everything else (e.g. pipes) is read into a buffer first
+	LibertyAst *ast = NULL;
+	void *data = regular_file && st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0) : MAP_FAILED;
+	if (data != MAP_FAILED) {
+		LibertyParser parser((const char*)data, st.st_size, filter);
+		std::swap(ast, parser.ast);
+		munmap(data, st.st_size);
+	} else {
+		LibertyParser parser(f, filter);
+		std::swap(ast, parser.ast);
+	}
+
+	// the AST of a non-regular file is kept until the next call for the
+	// same filename but is never returned as a cache hit
+	liberty_cache_entry_t &entry = liberty_cache[filename];
+	entry.dev = regular_file ? st.st_dev : 0;
+	entry.ino = regular_file ? st.st_ino : 0;
+	entry.size = regular_file ? st.st_size : 0;
+	entry.mtime = regular_file ? st.st_mtime : 0;
+	entry.filtered = filter != NULL;
+	entry.filter = filter != NULL ? *filter : LibertyFilter();
+	entry.ast = ast;
+
+	return ast;
+}
+
 #else
 
 void LibertyParser::error()
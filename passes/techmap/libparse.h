@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 
 namespace PASS_DFFLIBMAP
 {
@@ -39,17 +40,40 @@ namespace PASS_DFFLIBMAP
 		static std::set<std::string> whitelist;
 	};
 
+	// selects the parts of a liberty file that are parsed into the AST. groups and
+	// attributes with a path (e.g. "/library/cell/pin") that is not in 'paths' are
+	// skipped, "<path>/*" selects everything below <path>. a group with an entry in
+	// 'required' is dropped if it has no child with one of the listed ids.
+	struct LibertyFilter
+	{
+		std::set<std::string> paths;
+		std::map<std::string, std::set<std::string>> required;
+		bool operator==(const LibertyFilter &other) const { return paths == other.paths && required == other.required; }
+		bool keep(const std::string &path, bool path_ok) const;
+		bool keep(LibertyAst *ast, const std::string &path, bool path_ok) const;
+	};
+
 	struct LibertyParser
 	{
-		FILE *f;
+		std::string buffer;
+		const char *p, *end;
 		int line;
+		const LibertyFilter *filter;
 		LibertyAst *ast;
-		LibertyParser(FILE *f) : f(f), line(1), ast(parse()) {}
+		LibertyParser(FILE *f, const LibertyFilter *filter = NULL);
+		LibertyParser(const char *data, size_t size, const LibertyFilter *filter = NULL);
 		~LibertyParser() { if (ast) delete ast; }
 		int lexer(std::string &str);
-		LibertyAst *parse();
+		void skip_group();
+		LibertyAst *parse(std::string path = "", bool path_ok = false);
 		void error();
 	};
+
+	// parse the liberty file that is opened as 'f' or return the AST from an
+	// earlier call for the same (unchanged) file. the returned AST is owned by
+	// the cache and stays valid until the file is parsed again. a cached AST that
+	// was parsed without filter is also returned for requests with a filter.
+	LibertyAst *liberty_cache_parse(FILE *f, std::string filename, const LibertyFilter *filter = NULL);
 }
 
 #endif
@@ -31,6 +31,9 @@
 // see simplemap.cc
 extern void simplemap_get_mappers(std::map<std::string, void(*)(RTLIL::Module*, RTLIL::Cell*)> &mappers);
 
+// see arithmap.cc
+extern void arithmap_get_mappers(std::map<std::string, void(*)(RTLIL::Module*, RTLIL::Cell*)> &mappers);
+
 static void apply_prefix(std::string prefix, std::string &id)
 {
 	if (id[0] == '\\')
@@ -483,6 +486,9 @@ struct TechmapPass : public Pass {
 		log("\n");
 		log("When a module in the map file has the 'techmap_simplemap' attribute set, techmap\n");
 		log("will use 'simplemap' (see 'help simplemap') to map cells matching the module.\n");
+		log("The cells $add, $sub, $neg, $lt, $le, $gt, $ge, $eq, $ne, $eqx, $nex, $shl,\n");
+		log("$shr, $sshl and $sshr are mapped this way using the ripple carry adders and\n");
+		log("barrel shifters of the 'arithmap' pass (see 'help arithmap').\n");
 		log("\n");
 		log("All wires in the modules from the map file matching the pattern _TECHMAP_*\n");
 		log("or *._TECHMAP_* are special wires that are used to pass instructions from\n");
@@ -581,6 +587,7 @@ struct TechmapPass : public Pass {
 
 		TechmapWorker worker;
 		simplemap_get_mappers(worker.simplemap_mappers);
+		arithmap_get_mappers(worker.simplemap_mappers);
 
 		RTLIL::Design *map = new RTLIL::Design;
 		if (map_files.empty()) {
@@ -50,27 +50,8 @@ endmodule
 
 // --------------------------------------------------------
 
-module \$neg (A, Y);
-
-parameter A_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-input [A_WIDTH-1:0] A;
-output [Y_WIDTH-1:0] Y;
-
-\$sub #(
-	.A_SIGNED(A_SIGNED),
-	.B_SIGNED(A_SIGNED),
-	.A_WIDTH(1),
-	.B_WIDTH(A_WIDTH),
-	.Y_WIDTH(Y_WIDTH)
-) sub (
-	.A(1'b0),
-	.B(A),
-	.Y(Y)
-);
-
+(* techmap_simplemap *)
+module \$neg ;
 endmodule
 
 // --------------------------------------------------------
@@ -129,638 +110,86 @@ endmodule
 
 // --------------------------------------------------------
 
-module \$__shift (X, A, Y);
-
-parameter WIDTH = 1;
-parameter SHIFT = 0;
-
-input X;
-input [WIDTH-1:0] A;
-output [WIDTH-1:0] Y;
-
-genvar i;
-generate
-	for (i = 0; i < WIDTH; i = i + 1) begin:V
-		if (i+SHIFT < 0) begin
-			assign Y[i] = 0;
-		end else
-		if (i+SHIFT < WIDTH) begin
-			assign Y[i] = A[i+SHIFT];
-		end else begin
-			assign Y[i] = X;
-		end
-	end
-endgenerate
-
-endmodule
-
-// --------------------------------------------------------
-
-module \$shl (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-parameter WIDTH = Y_WIDTH;
-localparam BB_WIDTH = $clog2(WIDTH) + 2 < B_WIDTH ? $clog2(WIDTH) + 2 : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-genvar i;
-generate
-	wire [WIDTH*(BB_WIDTH+1)-1:0] chain;
-	\$bu0 #(
-		.A_SIGNED(A_SIGNED),
-		.A_WIDTH(A_WIDTH),
-		.Y_WIDTH(WIDTH)
-	) expand (
-		.A(A),
-		.Y(chain[WIDTH-1:0])
-	);
-	assign Y = chain[WIDTH*(BB_WIDTH+1)-1 : WIDTH*BB_WIDTH];
-	for (i = 0; i < BB_WIDTH; i = i + 1) begin:V
-		wire [WIDTH-1:0] unshifted, shifted, result;
-		assign unshifted = chain[WIDTH*i + WIDTH-1 : WIDTH*i];
-		assign chain[WIDTH*(i+1) + WIDTH-1 : WIDTH*(i+1)] = result;
-		wire BBIT;
-		if (i == BB_WIDTH-1 && BB_WIDTH < B_WIDTH)
-			assign BBIT = |B[B_WIDTH-1:BB_WIDTH-1];
-		else
-			assign BBIT = B[i];
-		\$__shift #(
-			.WIDTH(WIDTH),
-			.SHIFT(0 - (2 ** (i > 30 ? 30 : i)))
-		) sh (
-			.X(0),
-			.A(unshifted),
-			.Y(shifted)
-		);
-		\$mux #(
-			.WIDTH(WIDTH)
-		) mux (
-			.A(unshifted),
-			.B(shifted),
-			.Y(result),
-			.S(BBIT)
-		);
-	end
-endgenerate
-
-endmodule
-
-// --------------------------------------------------------
-
-module \$shr (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > Y_WIDTH ? A_WIDTH : Y_WIDTH;
-localparam BB_WIDTH = $clog2(WIDTH) + 2 < B_WIDTH ? $clog2(WIDTH) + 2 : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-genvar i;
-generate
-	wire [WIDTH*(BB_WIDTH+1)-1:0] chain;
-	\$bu0 #(
-		.A_SIGNED(A_SIGNED),
-		.A_WIDTH(A_WIDTH),
-		.Y_WIDTH(WIDTH)
-	) expand (
-		.A(A),
-		.Y(chain[WIDTH-1:0])
-	);
-	assign Y = chain[WIDTH*(BB_WIDTH+1)-1 : WIDTH*BB_WIDTH];
-	for (i = 0; i < BB_WIDTH; i = i + 1) begin:V
-		wire [WIDTH-1:0] unshifted, shifted, result;
-		assign unshifted = chain[WIDTH*i + WIDTH-1 : WIDTH*i];
-		assign chain[WIDTH*(i+1) + WIDTH-1 : WIDTH*(i+1)] = result;
-		wire BBIT;
-		if (i == BB_WIDTH-1 && BB_WIDTH < B_WIDTH)
-			assign BBIT = |B[B_WIDTH-1:BB_WIDTH-1];
-		else
-			assign BBIT = B[i];
-		\$__shift #(
-			.WIDTH(WIDTH),
-			.SHIFT(2 ** (i > 30 ? 30 : i))
-		) sh (
-			.X(0),
-			.A(unshifted),
-			.Y(shifted)
-		);
-		\$mux #(
-			.WIDTH(WIDTH)
-		) mux (
-			.A(unshifted),
-			.B(shifted),
-			.Y(result),
-			.S(BBIT)
-		);
-	end
-endgenerate
-
-endmodule
-
-// --------------------------------------------------------
-
-module \$sshl (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = Y_WIDTH;
-localparam BB_WIDTH = $clog2(WIDTH) + 2 < B_WIDTH ? $clog2(WIDTH) + 2 : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-genvar i;
-generate
-	wire [WIDTH*(BB_WIDTH+1)-1:0] chain;
-	\$bu0 #(
-		.A_SIGNED(A_SIGNED),
-		.A_WIDTH(A_WIDTH),
-		.Y_WIDTH(WIDTH)
-	) expand (
-		.A(A),
-		.Y(chain[WIDTH-1:0])
-	);
-	assign Y = chain[WIDTH*(BB_WIDTH+1)-1 : WIDTH*BB_WIDTH];
-	for (i = 0; i < BB_WIDTH; i = i + 1) begin:V
-		wire [WIDTH-1:0] unshifted, shifted, result;
-		assign unshifted = chain[WIDTH*i + WIDTH-1 : WIDTH*i];
-		assign chain[WIDTH*(i+1) + WIDTH-1 : WIDTH*(i+1)] = result;
-		wire BBIT;
-		if (i == BB_WIDTH-1 && BB_WIDTH < B_WIDTH)
-			assign BBIT = |B[B_WIDTH-1:BB_WIDTH-1];
-		else
-			assign BBIT = B[i];
-		\$__shift #(
-			.WIDTH(WIDTH),
-			.SHIFT(0 - (2 ** (i > 30 ? 30 : i)))
-		) sh (
-			.X(0),
-			.A(unshifted),
-			.Y(shifted)
-		);
-		\$mux #(
-			.WIDTH(WIDTH)
-		) mux (
-			.A(unshifted),
-			.B(shifted),
-			.Y(result),
-			.S(BBIT)
-		);
-	end
-endgenerate
-
+(* techmap_simplemap *)
+module \$shl ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$sshr (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > Y_WIDTH ? A_WIDTH : Y_WIDTH;
-localparam BB_WIDTH = $clog2(WIDTH) + 2 < B_WIDTH ? $clog2(WIDTH) + 2 : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-genvar i;
-generate
-	wire [WIDTH*(BB_WIDTH+1)-1:0] chain;
-	\$bu0 #(
-		.A_SIGNED(A_SIGNED),
-		.A_WIDTH(A_WIDTH),
-		.Y_WIDTH(WIDTH)
-	) expand (
-		.A(A),
-		.Y(chain[WIDTH-1:0])
-	);
-	for (i = 0; i < Y_WIDTH; i = i + 1) begin:Y
-		if (i < WIDTH) begin
-			assign Y[i] = chain[WIDTH*BB_WIDTH + i];
-		end else
-		if (A_SIGNED) begin
-			assign Y[i] = chain[WIDTH*BB_WIDTH + WIDTH-1];
-		end else begin
-			assign Y[i] = 0;
-		end
-	end
-	for (i = 0; i < BB_WIDTH; i = i + 1) begin:V
-		wire [WIDTH-1:0] unshifted, shifted, result;
-		assign unshifted = chain[WIDTH*i + WIDTH-1 : WIDTH*i];
-		assign chain[WIDTH*(i+1) + WIDTH-1 : WIDTH*(i+1)] = result;
-		wire BBIT;
-		if (i == BB_WIDTH-1 && BB_WIDTH < B_WIDTH)
-			assign BBIT = |B[B_WIDTH-1:BB_WIDTH-1];
-		else
-			assign BBIT = B[i];
-		\$__shift #(
-			.WIDTH(WIDTH),
-			.SHIFT(2 ** (i > 30 ? 30 : i))
-		) sh (
-			.X(A_SIGNED && A[A_WIDTH-1]),
-			.A(unshifted),
-			.Y(shifted)
-		);
-		\$mux #(
-			.WIDTH(WIDTH)
-		) mux (
-			.A(unshifted),
-			.B(shifted),
-			.Y(result),
-			.S(BBIT)
-		);
-	end
-endgenerate
-
+(* techmap_simplemap *)
+module \$shr ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$__fulladd (A, B, C, X, Y);
-
-// {X, Y} = A + B + C
-input A, B, C;
-output X, Y;
-
-// {t1, t2} = A + B
-wire t1, t2, t3;
-
-\$_AND_ gate1 ( .A(A),  .B(B),  .Y(t1) );
-\$_XOR_ gate2 ( .A(A),  .B(B),  .Y(t2) );
-\$_AND_ gate3 ( .A(t2), .B(C),  .Y(t3) ); 
-\$_XOR_ gate4 ( .A(t2), .B(C),  .Y(Y)  );
-\$_OR_  gate5 ( .A(t1), .B(t3), .Y(X)  );
-
+(* techmap_simplemap *)
+module \$sshl ;
 endmodule
 
-
 // --------------------------------------------------------
 
-module \$__alu (A, B, Cin, Y, Cout, Csign);
-
-parameter WIDTH = 1;
-
-input [WIDTH-1:0] A, B;
-input Cin;
-
-output [WIDTH-1:0] Y;
-output Cout, Csign;
-
-wire [WIDTH:0] carry;
-assign carry[0] = Cin;
-assign Cout = carry[WIDTH];
-assign Csign = carry[WIDTH-1];
-
-genvar i;
-generate
-	for (i = 0; i < WIDTH; i = i + 1) begin:V
-		\$__fulladd adder (
-			.A(A[i]),
-			.B(B[i]),
-			.C(carry[i]),
-			.X(carry[i+1]),
-			.Y(Y[i])
-		);
-	end
-endgenerate
-
+(* techmap_simplemap *)
+module \$sshr ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$lt (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > B_WIDTH ? A_WIDTH : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire carry, carry_sign;
-wire [WIDTH-1:0] A_buf, B_buf, Y_buf;
-\$pos #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$pos #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-\$__alu #(
-	.WIDTH(WIDTH)
-) alu (
-	.A(A_buf),
-	.B(~B_buf),
-	.Cin(1'b1),
-	.Y(Y_buf),
-	.Cout(carry),
-	.Csign(carry_sign)
-);
-
-// ALU flags
-wire cf, of, zf, sf;
-assign cf = !carry;
-assign of = carry ^ carry_sign;
-assign zf = ~|Y_buf;
-assign sf = Y_buf[WIDTH-1];
-
-generate
-	if (A_SIGNED && B_SIGNED) begin
-		assign Y = of != sf;
-	end else begin
-		assign Y = cf;
-	end
-endgenerate
-
+(* techmap_simplemap *)
+module \$lt ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$le (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > B_WIDTH ? A_WIDTH : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire carry, carry_sign;
-wire [WIDTH-1:0] A_buf, B_buf, Y_buf;
-\$pos #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$pos #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-\$__alu #(
-	.WIDTH(WIDTH)
-) alu (
-	.A(A_buf),
-	.B(~B_buf),
-	.Cin(1'b1),
-	.Y(Y_buf),
-	.Cout(carry),
-	.Csign(carry_sign)
-);
-
-// ALU flags
-wire cf, of, zf, sf;
-assign cf = !carry;
-assign of = carry ^ carry_sign;
-assign zf = ~|Y_buf;
-assign sf = Y_buf[WIDTH-1];
-
-generate
-	if (A_SIGNED && B_SIGNED) begin
-		assign Y = zf || (of != sf);
-	end else begin
-		assign Y = zf || cf;
-	end
-endgenerate
-
+(* techmap_simplemap *)
+module \$le ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$eq (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > B_WIDTH ? A_WIDTH : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire carry, carry_sign;
-wire [WIDTH-1:0] A_buf, B_buf;
-\$bu0 #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$bu0 #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-assign Y = ~|(A_buf ^ B_buf);
-
+(* techmap_simplemap *)
+module \$eq ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$ne (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > B_WIDTH ? A_WIDTH : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire carry, carry_sign;
-wire [WIDTH-1:0] A_buf, B_buf;
-\$bu0 #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$bu0 #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-assign Y = |(A_buf ^ B_buf);
-
+(* techmap_simplemap *)
+module \$ne ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$eqx (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > B_WIDTH ? A_WIDTH : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire carry, carry_sign;
-wire [WIDTH-1:0] A_buf, B_buf;
-\$pos #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$pos #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-assign Y = ~|(A_buf ^ B_buf);
-
+(* techmap_simplemap *)
+module \$eqx ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$nex (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-localparam WIDTH = A_WIDTH > B_WIDTH ? A_WIDTH : B_WIDTH;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire carry, carry_sign;
-wire [WIDTH-1:0] A_buf, B_buf;
-\$pos #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$pos #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-assign Y = |(A_buf ^ B_buf);
-
+(* techmap_simplemap *)
+module \$nex ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$ge (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-\$le #(
-	.A_SIGNED(B_SIGNED),
-	.B_SIGNED(A_SIGNED),
-	.A_WIDTH(B_WIDTH),
-	.B_WIDTH(A_WIDTH),
-	.Y_WIDTH(Y_WIDTH)
-) ge_via_le (
-	.A(B),
-	.B(A),
-	.Y(Y)
-);
-
+(* techmap_simplemap *)
+module \$ge ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$gt (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-\$lt #(
-	.A_SIGNED(B_SIGNED),
-	.B_SIGNED(A_SIGNED),
-	.A_WIDTH(B_WIDTH),
-	.B_WIDTH(A_WIDTH),
-	.Y_WIDTH(Y_WIDTH)
-) gt_via_lt (
-	.A(B),
-	.B(A),
-	.Y(Y)
-);
-
+(* techmap_simplemap *)
+module \$gt ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$add (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire [Y_WIDTH-1:0] A_buf, B_buf;
-\$pos #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(Y_WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$pos #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(Y_WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-\$__alu #(
-	.WIDTH(Y_WIDTH)
-) alu (
-	.A(A_buf),
-	.B(B_buf),
-	.Cin(1'b0),
-	.Y(Y)
-);
-
+(* techmap_simplemap *)
+module \$add ;
 endmodule
 
 // --------------------------------------------------------
 
-module \$sub (A, B, Y);
-
-parameter A_SIGNED = 0;
-parameter B_SIGNED = 0;
-parameter A_WIDTH = 1;
-parameter B_WIDTH = 1;
-parameter Y_WIDTH = 1;
-
-input [A_WIDTH-1:0] A;
-input [B_WIDTH-1:0] B;
-output [Y_WIDTH-1:0] Y;
-
-wire [Y_WIDTH-1:0] A_buf, B_buf;
-\$pos #(.A_SIGNED(A_SIGNED), .A_WIDTH(A_WIDTH), .Y_WIDTH(Y_WIDTH)) A_conv (.A(A), .Y(A_buf));
-\$pos #(.A_SIGNED(B_SIGNED), .A_WIDTH(B_WIDTH), .Y_WIDTH(Y_WIDTH)) B_conv (.A(B), .Y(B_buf));
-
-\$__alu #(
-	.WIDTH(Y_WIDTH)
-) alu (
-	.A(A_buf),
-	.B(~B_buf),
-	.Cin(1'b1),
-	.Y(Y)
-);
-
+(* techmap_simplemap *)
+module \$sub ;
 endmodule
 
 // --------------------------------------------------------
@@ -0,0 +1,45 @@
+module \$__XILINX_RAMB18_1024X18 (WR1_CLK, WR1_EN, WR1_ADDR, WR1_DATA, RD1_CLK, RD1_ADDR, RD1_DATA);
+
+  input WR1_CLK, WR1_EN;
+  input [9:0] WR1_ADDR;
+  input [17:0] WR1_DATA;
+
+  input RD1_CLK;
+  input [9:0] RD1_ADDR;
+  output [17:0] RD1_DATA;
+
+  RAMB18E1 #(
+    .RAM_MODE("TDP"),
+    .READ_WIDTH_A(18),
+    .READ_WIDTH_B(0),
+    .WRITE_WIDTH_A(0),
+    .WRITE_WIDTH_B(18),
+    .WRITE_MODE_A("READ_FIRST"),
+    .WRITE_MODE_B("READ_FIRST"),
+    .DOA_REG(0),
+    .DOB_REG(0)
+  ) _TECHMAP_REPLACE_ (
+    .CLKARDCLK(RD1_CLK),
+    .ENARDEN(1'b1),
+    .REGCEAREGCE(1'b0),
+    .RSTRAMARSTRAM(1'b0),
+    .RSTREGARSTREG(1'b0),
+    .ADDRARDADDR({RD1_ADDR, 4'b0}),
+    .WEA(2'b0),
+    .DIADI(16'b0),
+    .DIPADIP(2'b0),
+    .DOADO(RD1_DATA[15:0]),
+    .DOPADOP(RD1_DATA[17:16]),
+
+    .CLKBWRCLK(WR1_CLK),
+    .ENBWREN(1'b1),
+    .REGCEB(1'b0),
+    .RSTRAMB(1'b0),
+    .RSTREGB(1'b0),
+    .ADDRBWRADDR({WR1_ADDR, 4'b0}),
+    .WEBWE({2'b0, WR1_EN, WR1_EN}),
+    .DIBDI(WR1_DATA[15:0]),
+    .DIPBDIP(WR1_DATA[17:16])
+  );
+
+endmodule
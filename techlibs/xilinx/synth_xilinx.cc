@@ -68,12 +68,17 @@ struct SynthXilinxPass : public Pass {
 		log("    coarse:\n");
 		log("        proc\n");
 		log("        opt\n");
-		log("        memory\n");
+		log("        memory -nomap\n");
 		log("        clean\n");
 		log("        fsm\n");
 		log("        opt\n");
 		log("\n");
+		log("    map_bram:\n");
+		log("        memory_bram -share_rules xilinx/brams.txt\n");
+		log("        techmap -share_map xilinx/brams.v\n");
+		log("\n");
 		log("    fine:\n");
+		log("        memory_map\n");
 		log("        techmap\n");
 		log("        opt\n");
 		log("\n");
@@ -162,14 +167,21 @@ struct SynthXilinxPass : public Pass {
 		{
 			Pass::call(design, "proc");
 			Pass::call(design, "opt");
-			Pass::call(design, "memory");
+			Pass::call(design, "memory -nomap");
 			Pass::call(design, "clean");
 			Pass::call(design, "fsm");
 			Pass::call(design, "opt");
 		}
 
+		if (check_label(active, run_from, run_to, "map_bram"))
+		{
+			Pass::call(design, "memory_bram -share_rules xilinx/brams.txt");
+			Pass::call(design, "techmap -share_map xilinx/brams.v");
+		}
+
 		if (check_label(active, run_from, run_to, "fine"))
 		{
+			Pass::call(design, "memory_map");
 			Pass::call(design, "techmap");
 			Pass::call(design, "opt");
 		}
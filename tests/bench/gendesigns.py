@@ -0,0 +1,123 @@
+#!/usr/bin/python
+#
+# Generate scalable synthetic designs for the yosys benchmark suite.
+# Every design family takes a size parameter 'n'. The generated files
+# are named <family>_<n>.v and have a top module named 'top'.
+#
+
+from __future__ import division
+from __future__ import print_function
+
+import argparse
+import os
+import random
+
+def gen_adder(f, n):
+    # three chained n-bit adders
+    print("module top(input [%d:0] a, b, c, d, output [%d:0] y);" % (n-1, n-1), file=f)
+    print("assign y = a + b + c + d;", file=f)
+    print("endmodule", file=f)
+
+def gen_mult(f, n):
+    # n x n bit multiplier with registered inputs and output
+    print("module top(input clk, input [%d:0] a, b, output reg [%d:0] y);" % (n-1, 2*n-1), file=f)
+    print("reg [%d:0] ra, rb;" % (n-1), file=f)
+    print("always @(posedge clk) begin", file=f)
+    print("  ra <= a; rb <= b; y <= ra * rb;", file=f)
+    print("end", file=f)
+    print("endmodule", file=f)
+
+def gen_muxtree(f, n):
+    # n-deep if/else-if chain over a 16 bit data path
+    print("module top(input [%d:0] sel, input [%d:0] data, output reg [15:0] y);" % (n-1, 16*n-1), file=f)
+    print("always @* begin", file=f)
+    print("  y = 16'd0;", file=f)
+    for i in range(n):
+        print("  %sif (sel[%d]) y = data[%d:%d];" % ("else " if i else "", i, 16*i+15, 16*i), file=f)
+    print("end", file=f)
+    print("endmodule", file=f)
+
+def gen_memory(f, n):
+    # memory with 2^n words of 32 bits, one write and two read ports
+    print("module top(input clk, we, input [%d:0] wa, ra1, ra2, input [31:0] wd, output reg [31:0] rd1, rd2);" % (n-1), file=f)
+    print("reg [31:0] mem [0:%d];" % (2**n - 1), file=f)
+    print("always @(posedge clk) begin", file=f)
+    print("  if (we) mem[wa] <= wd;", file=f)
+    print("  rd1 <= mem[ra1];", file=f)
+    print("  rd2 <= mem[ra2];", file=f)
+    print("end", file=f)
+    print("endmodule", file=f)
+
+def gen_hier(f, n):
+    # n instances of a small parametric pipeline stage, chained together
+    print("module stage #(parameter K = 0) (input clk, input [7:0] a, output reg [7:0] y);", file=f)
+    print("always @(posedge clk) y <= (a ^ K) + {a[6:0], a[7]};", file=f)
+    print("endmodule", file=f)
+    print("module top(input clk, input [7:0] a, output [7:0] y);", file=f)
+    print("wire [%d:0] w;" % (8*n+7), file=f)
+    print("assign w[7:0] = a;", file=f)
+    for i in range(n):
+        print("stage #(.K(%d)) s%d (.clk(clk), .a(w[%d:%d]), .y(w[%d:%d]));" % (i % 256, i, 8*i+7, 8*i, 8*i+15, 8*i+8), file=f)
+    print("assign y = w[%d:%d];" % (8*n+7, 8*n), file=f)
+    print("endmodule", file=f)
+
+def gen_fsm(f, n):
+    # n independent FSMs with 12 states each and random transitions, the
+    # SEED parameter permutes the transition targets and the outputs, so
+    # every instance is a different FSM
+    rng = random.Random(n)
+    print("module fsm #(parameter SEED = 0) (input clk, rst, input [3:0] in, output reg [3:0] out);", file=f)
+    print("reg [3:0] state;", file=f)
+    print("always @(posedge clk) begin", file=f)
+    print("  if (rst) begin", file=f)
+    print("    state <= 0;", file=f)
+    print("  end else begin", file=f)
+    print("    case (state)", file=f)
+    for s in range(12):
+        a, b = rng.randrange(12), rng.randrange(12)
+        print("      %d: state <= in[%d] ? (%d + 5*SEED) %% 12 : in[%d] ? (%d + 7*SEED) %% 12 : %d;" % (s, s % 4, a, (s+1) % 4, b, s), file=f)
+    print("      default: state <= 0;", file=f)
+    print("    endcase", file=f)
+    print("  end", file=f)
+    print("end", file=f)
+    print("always @* begin", file=f)
+    print("  case (state)", file=f)
+    for s in range(12):
+        print("    %d: out = (%d + 3*SEED) %% 16;" % (s, rng.randrange(16)), file=f)
+    print("    default: out = 4'd0;", file=f)
+    print("  endcase", file=f)
+    print("end", file=f)
+    print("endmodule", file=f)
+    print("module top(input clk, rst, input [%d:0] in, output [%d:0] out);" % (4*n-1, 4*n-1), file=f)
+    for i in range(n):
+        print("fsm #(.SEED(%d)) f%d (.clk(clk), .rst(rst), .in(in[%d:%d]), .out(out[%d:%d]));" % (i, i, 4*i+3, 4*i, 4*i+3, 4*i), file=f)
+    print("endmodule", file=f)
+
+generators = {
+    "adder":   (gen_adder,   [ 32, 128, 512 ]),
+    "mult":    (gen_mult,    [ 8, 16, 32 ]),
+    "muxtree": (gen_muxtree, [ 64, 256, 1024 ]),
+    "memory":  (gen_memory,  [ 4, 6, 8 ]),
+    "hier":    (gen_hier,    [ 16, 128, 1024 ]),
+    "fsm":     (gen_fsm,     [ 4, 16, 64 ]),
+}
+
+parser = argparse.ArgumentParser(description='Generate designs for the yosys benchmark suite.')
+parser.add_argument('-o', metavar='dir', default='designs', help='output directory (default: designs)')
+parser.add_argument('-f', metavar='family', action='append', help='only generate this design family (can be repeated)')
+parser.add_argument('-n', metavar='size', action='append', type=int, help='override the list of sizes (can be repeated)')
+args = parser.parse_args()
+
+if not os.path.isdir(args.o):
+    os.makedirs(args.o)
+
+for family in sorted(generators.keys()):
+    if args.f and family not in args.f:
+        continue
+    gen, sizes = generators[family]
+    for n in (args.n or sizes):
+        filename = os.path.join(args.o, "%s_%d.v" % (family, n))
+        with open(filename, "w") as f:
+            print("// generated by gendesigns.py: %s, n=%d" % (family, n), file=f)
+            gen(f, n)
+        print(filename)
@@ -0,0 +1,118 @@
+#!/usr/bin/python
+#
+# Run the standard synthesis script on each benchmark design and report
+# per-pass runtime and peak memory. The results can be stored as a baseline
+# (-u) and later runs are compared against this baseline.
+#
+
+from __future__ import division
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+default_script = "hierarchy -top top; proc; opt; memory; opt; fsm; opt; techmap; opt; abc; opt"
+
+parser = argparse.ArgumentParser(description='Run the yosys benchmark suite.')
+parser.add_argument('designs', metavar='FILE', nargs='+', help='verilog files to synthesize')
+parser.add_argument('-y', metavar='yosys', default='../../yosys', help='yosys executable (default: ../../yosys)')
+parser.add_argument('-s', metavar='script', default=default_script, help='synthesis script (default: "%s")' % default_script)
+parser.add_argument('-b', metavar='baseline', default='baseline.txt', help='baseline file (default: baseline.txt)')
+parser.add_argument('-u', action='store_true', help='write results to the baseline file instead of comparing')
+parser.add_argument('-t', metavar='tolerance', default=0.2, type=float, help='relative slowdown reported as regression (default: 0.2)')
+parser.add_argument('-m', metavar='min_time', default=0.1, type=float, help='ignore runtime differences below this many seconds (default: 0.1)')
+parser.add_argument('-l', metavar='logdir', default='logs', help='directory for yosys log files (default: logs)')
+args = parser.parse_args()
+
+commands = [ cmd.strip() for cmd in args.s.split(';') if cmd.strip() != "" ]
+timestamp_re = re.compile(r'^\[([0-9]+\.[0-9]+)\] (.*)$')
+running_re = re.compile(r"^-- Running pass `(.*)' --$")
+
+def run_design(filename):
+    design = os.path.splitext(os.path.basename(filename))[0]
+    logfile = os.path.join(args.l, design + ".log")
+    cmdline = [ args.y, "-q", "-t", "-l", logfile ]
+    for cmd in commands:
+        cmdline += [ "-p", cmd ]
+    cmdline.append(filename)
+
+    proc = subprocess.Popen(cmdline)
+    _, status, rusage = os.wait4(proc.pid, 0)
+    if status != 0:
+        print("ERROR: yosys failed on %s, see %s." % (filename, logfile), file=sys.stderr)
+        sys.exit(1)
+
+    # every '-p' command is logged as "-- Running pass `cmd' --" at top level,
+    # the time until the next top level message is the runtime of that command
+    results = [ ]
+    current_cmd, current_start, last_time = "read", 0.0, 0.0
+    with open(logfile) as f:
+        for line in f:
+            m = timestamp_re.match(line.rstrip("\n"))
+            if not m:
+                continue
+            last_time = float(m.group(1))
+            m = running_re.match(m.group(2))
+            if m:
+                results.append((current_cmd, last_time - current_start))
+                current_cmd, current_start = m.group(1), last_time
+    results.append((current_cmd, last_time - current_start))
+
+    # ru_maxrss is in kB on Linux
+    return design, results, rusage.ru_maxrss
+
+def read_baseline():
+    baseline = dict()
+    if not os.path.isfile(args.b):
+        return baseline
+    with open(args.b) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 3:
+                baseline[(fields[0], fields[1])] = float(fields[2])
+    return baseline
+
+if not os.path.isdir(args.l):
+    os.makedirs(args.l)
+
+baseline = read_baseline()
+new_baseline = [ ]
+regressions = 0
+
+for filename in args.designs:
+    design, results, maxrss = run_design(filename)
+    print("\n%s:" % design)
+    for idx, (cmd, runtime) in enumerate(results):
+        key = "%d:%s" % (idx, cmd.replace(" ", "_"))
+        new_baseline.append("%s %s %.3f" % (design, key, runtime))
+        line = "  %-40s %10.3f s" % (cmd, runtime)
+        if (design, key) in baseline:
+            old = baseline[(design, key)]
+            line += "  (baseline %10.3f s" % old
+            if runtime - old > args.m and runtime > old * (1 + args.t):
+                line += ", REGRESSION"
+                regressions += 1
+            line += ")"
+        print(line)
+    new_baseline.append("%s maxrss %d" % (design, maxrss))
+    line = "  %-40s %10.1f MB" % ("peak memory", maxrss / 1024)
+    if (design, "maxrss") in baseline:
+        old = baseline[(design, "maxrss")]
+        line += "  (baseline %10.1f MB" % (old / 1024)
+        if maxrss > old * (1 + args.t):
+            line += ", REGRESSION"
+            regressions += 1
+        line += ")"
+    print(line)
+
+if args.u:
+    with open(args.b, "w") as f:
+        for line in new_baseline:
+            print(line, file=f)
+    print("\nWrote baseline to %s." % args.b)
+elif regressions > 0:
+    print("\nFound %d regressions against %s." % (regressions, args.b))
+    sys.exit(1)
@@ -0,0 +1,11 @@
+#!/bin/bash
+#
+# Usage: bash run-bench.sh [run-bench.py options]
+#
+# Generates the benchmark designs (if needed) and runs the benchmark. Use
+# 'bash run-bench.sh -u' to store the results as new baseline.
+#
+set -e
+make -C ../..
+test -d designs || python gendesigns.py -o designs > /dev/null
+exec python run-bench.py "$@" designs/*.v
@@ -0,0 +1,65 @@
+module arith(a, b, c, s, add_u, add_s, add_m, sub_u, sub_s, sub_m, neg_u,
+             neg_s, neg_m, cmp, eq, shl_u, shl_w, shr_u, shr_w, sshr_s, sshr_w,
+             sshl_s, shr_c, shl_c, sshr_c);
+
+input [3:0] a;
+input [5:0] b;
+input [2:0] c;
+input [3:0] s;
+
+wire signed [3:0] sa = a;
+wire signed [5:0] sb = b;
+wire signed [2:0] sc = c;
+
+output [6:0] add_u = a + b;
+output signed [6:0] add_s = sa + sb;
+output [4:0] add_m = a + c + 1'b1;
+
+output [6:0] sub_u = a - b;
+output signed [5:0] sub_s = sa - sc;
+output [5:0] sub_m = c - b;
+
+output [4:0] neg_u = -a;
+output signed [6:0] neg_s = -sb;
+output [2:0] neg_m = -c;
+
+output [15:0] cmp = { a < b, a <= b, a > b, a >= b,
+                      sa < sb, sa <= sb, sa > sb, sa >= sb,
+                      sc < sa, sc >= sa, sb > 6'sd3, a >= 4'd9,
+                      a < c, c <= a, sa > sc, sb <= -6'sd2 };
+
+output [7:0] eq = { a == b, a != b, a === b, a !== b,
+                    sa == sc, sa != sc, c == 3'd5, b !== 6'd17 };
+
+output [3:0] shl_u = a << s;
+output [7:0] shl_w = a << s[2:0];
+output [5:0] shr_u = b >> s;
+output [2:0] shr_w = b >> c;
+output signed [5:0] sshr_s = sb >>> s;
+output signed [7:0] sshr_w = sa >>> c;
+output signed [3:0] sshl_s = sa <<< c;
+
+// shift amounts with constant bits
+output [5:0] shr_c = b >> {s[1:0], 1'b0};
+output [5:0] shl_c = a << {1'b0, s[0], 1'b0};
+output signed [5:0] sshr_c = sb >>> {s[2:1], 2'b00};
+
+endmodule
+
+module mult(a, b, c, mul_u, mul_s, mul_m, mul_t, mul_c);
+
+input [3:0] a;
+input [4:0] b;
+input [2:0] c;
+
+wire signed [3:0] sa = a;
+wire signed [4:0] sb = b;
+wire signed [2:0] sc = c;
+
+output [8:0] mul_u = a * b;
+output signed [8:0] mul_s = sa * sb;
+output [5:0] mul_m = c * sb;
+output signed [4:0] mul_t = sa * sc;
+output [5:0] mul_c = a * 4'd5;
+
+endmodule
@@ -0,0 +1,75 @@
+// an FSM with 13 control inputs, so that fsm_extract uses the SAT solver by default
+module fsm_wide(clk, rst, in, out);
+
+input clk, rst;
+input [12:0] in;
+output reg [2:0] out;
+
+(* fsm_encoding = "auto" *)
+reg [1:0] state;
+
+always @(posedge clk) begin
+	if (rst)
+		state <= 0;
+	else
+		case (state)
+			0:	if (in[3:0] == 4'd9)
+					state <= 1;
+				else if (in[12])
+					state <= 2;
+			1:	if (in[11:4] == 8'h5a)
+					state <= 3;
+				else if (!in[0])
+					state <= 0;
+			2:	if (^in[12:8])
+					state <= 1;
+			3:	if (in == 13'h1234)
+					state <= 0;
+				else if (in[7] && in[2])
+					state <= 2;
+		endcase
+end
+
+always @* begin
+	case (state)
+		0: out = {in[12], 2'b01};
+		1: out = {1'b0, in[5], 1'bx};
+		2: out = 3'b110;
+		default: out = 3'bxxx;
+	endcase
+end
+
+endmodule
+
+module fsm_small(clk, rst, a, b, y);
+
+input clk, rst, a, b;
+output reg [1:0] y;
+
+(* fsm_encoding = "auto" *)
+reg [2:0] state;
+
+always @(posedge clk) begin
+	if (rst)
+		state <= 0;
+	else
+		case (state)
+			0: state <= a ? 1 : b ? 2 : 0;
+			1: state <= b ? 3 : 1;
+			2: state <= a && b ? 4 : 0;
+			3: state <= !a ? 4 : 1;
+			4: state <= 0;
+		endcase
+end
+
+always @* begin
+	case (state)
+		0: y = 2'b00;
+		1: y = {a, 1'bx};
+		3: y = 2'b10;
+		4: y = {1'b1, b};
+		default: y = 2'bxx;
+	endcase
+end
+
+endmodule
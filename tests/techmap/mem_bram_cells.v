@@ -0,0 +1,20 @@
+module \$__TEST_BRAM (WR1_CLK, WR1_EN, WR1_ADDR, WR1_DATA, RD1_CLK, RD1_ADDR, RD1_DATA);
+
+input WR1_CLK, WR1_EN;
+input [3:0] WR1_ADDR;
+input [3:0] WR1_DATA;
+
+input RD1_CLK;
+input [3:0] RD1_ADDR;
+output reg [3:0] RD1_DATA;
+
+reg [3:0] memory [0:15];
+
+always @(posedge WR1_CLK)
+	if (WR1_EN)
+		memory[WR1_ADDR] <= WR1_DATA;
+
+always @(posedge RD1_CLK)
+	RD1_DATA <= memory[RD1_ADDR];
+
+endmodule
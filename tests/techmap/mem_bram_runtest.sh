@@ -0,0 +1,17 @@
+#!/bin/bash
+
+set -ev
+
+../../yosys -b 'verilog -noattr' -o mem_bram_gold.v -p 'proc; opt; memory; opt' mem_bram_uut.v
+../../yosys -b 'verilog -noattr' -o mem_bram_gate.v -p 'proc; opt; memory -nomap; memory_bram -rules mem_bram_rules.txt; select -assert-none t:$mem; memory_map; opt; stat' mem_bram_uut.v
+
+iverilog -o mem_bram_gold_tb mem_bram_tb.v mem_bram_gold.v
+iverilog -o mem_bram_gate_tb mem_bram_tb.v mem_bram_gate.v mem_bram_cells.v
+
+./mem_bram_gold_tb > mem_bram_gold_tb.out
+./mem_bram_gate_tb > mem_bram_gate_tb.out
+
+diff -u mem_bram_gold_tb.out mem_bram_gate_tb.out
+rm -f mem_bram_{gold,gate}.v
+rm -f mem_bram_{gold,gate}_tb{,.out}
+: OK
@@ -0,0 +1,42 @@
+module tb;
+
+reg clk, wen;
+reg [5:0] addr, raddr1, raddr2, wdata;
+wire [3:0] rdata_sp, rdata_dp1, rdata_dp2;
+wire [5:0] rdata_big;
+
+uut uut (clk, wen, addr, wdata, raddr1, raddr2, rdata_sp, rdata_dp1, rdata_dp2, rdata_big);
+
+initial begin
+	#5 clk <= 0;
+	repeat (600) #5 clk <= ~clk;
+	#5 $finish;
+end
+
+integer i;
+
+initial begin
+	// write all addresses first, so that no undefined data is read
+	for (i = 0; i < 64; i = i+1) begin
+		wen <= 1;
+		addr <= i;
+		wdata <= i ^ 6'h2a;
+		raddr1 <= i;
+		raddr2 <= i;
+		@(posedge clk);
+	end
+	forever begin
+		wen <= $random;
+		addr <= $random;
+		wdata <= $random;
+		raddr1 <= $random;
+		raddr2 <= $random;
+		@(posedge clk);
+	end
+end
+
+always @(posedge clk)
+	if (i == 64)
+		$display("%d %d %d %d %d %d %d", wen, addr, raddr1, rdata_sp, rdata_dp1, rdata_dp2, rdata_big);
+
+endmodule
@@ -0,0 +1,37 @@
+module uut (clk, wen, addr, wdata, raddr1, raddr2, rdata_sp, rdata_dp1, rdata_dp2, rdata_big);
+
+input clk, wen;
+input [5:0] addr, raddr1, raddr2;
+input [5:0] wdata;
+output reg [3:0] rdata_sp, rdata_dp1, rdata_dp2;
+output reg [5:0] rdata_big;
+
+// single port: fits into one block ram
+reg [3:0] mem_sp [0:15];
+
+always @(posedge clk) begin
+	if (wen)
+		mem_sp[addr[3:0]] <= wdata[3:0];
+	rdata_sp <= mem_sp[addr[3:0]];
+end
+
+// one write and two read ports: the block ram is replicated
+reg [3:0] mem_dp [0:15];
+
+always @(posedge clk) begin
+	if (wen)
+		mem_dp[addr[3:0]] <= wdata[5:2];
+	rdata_dp1 <= mem_dp[raddr1[3:0]];
+	rdata_dp2 <= mem_dp[raddr2[3:0]];
+end
+
+// wider and deeper than one block ram: 4 x 2 tiles
+reg [5:0] mem_big [0:63];
+
+always @(posedge clk) begin
+	if (wen)
+		mem_big[addr] <= wdata;
+	rdata_big <= mem_big[raddr1];
+end
+
+endmodule
@@ -0,0 +1,24 @@
+// the cells for x and y form a loop on the cell level,
+// but x[0] only drives y[1] and y[0] only drives x[1]
+module no_bit_loop(a, b, c, d, x, y);
+
+input [1:0] a, b;
+input c, d;
+output [1:0] x, y;
+
+assign x = a & {y[0], c};
+assign y = b & {x[0], d};
+
+endmodule
+
+// here x[1] and y[1] form a loop
+module bit_loop(a, b, c, d, x, y);
+
+input [1:0] a, b;
+input c, d;
+output [1:0] x, y;
+
+assign x = a & {y[1], c};
+assign y = b & {x[1], d};
+
+endmodule